@@ -1,89 +1,642 @@
+#include <deque>
 #include <iostream>
 #include <string>
 #include <vector>
 
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 
-int
-main()
+#ifdef __linux__
+#include <atomic>
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+template<typename Int>
+void
+WriteLittleEndian(Int value)
+{
+  for (size_t i = 0; i < sizeof(Int); i++)
+    fputc(int((value >> (i * 8)) & 0xff), stdout);
+}
+
+/// Writes the header used by the binary protocol (version 2).
+void
+WriteFrameHeader(uint32_t w, uint32_t h, uint64_t request_id)
+{
+  WriteLittleEndian(uint32_t(0x324e5356)); // <- magic number ("VSN2")
+  WriteLittleEndian(uint16_t(1));          // <- message type (RGB buffer)
+  WriteLittleEndian(uint16_t(1));          // <- pixel format (RGB888)
+  WriteLittleEndian(w);
+  WriteLittleEndian(h);
+  WriteLittleEndian(request_id);
+  WriteLittleEndian(uint64_t(w) * h * 3); // <- payload size
+}
+
+/// Writes a frame whose pixels were written into the shared frame ring.
+void
+WriteSharedFrame(uint32_t w, uint32_t h, uint64_t request_id, uint64_t pos)
+{
+  WriteLittleEndian(uint32_t(0x324e5356)); // <- magic number ("VSN2")
+  WriteLittleEndian(uint16_t(2));          // <- message type (shared RGB)
+  WriteLittleEndian(uint16_t(1));          // <- pixel format (RGB888)
+  WriteLittleEndian(w);
+  WriteLittleEndian(h);
+  WriteLittleEndian(request_id);
+  WriteLittleEndian(uint64_t(8)); // <- payload size (just the position)
+  WriteLittleEndian(pos);
+}
+
+#ifdef __linux__
+
+/// The shared memory that the GUI passes to the renderer when it is spawned
+/// locally. Pixels are written straight into it, instead of through standard
+/// output. See gui/shared_frame_ring.hpp for the layout.
+class FrameRing final
 {
-  int i = 0;
+public:
+  ~FrameRing()
+  {
+    if (m_data)
+      munmap(m_data - 4096, m_capacity + 4096);
+  }
+
+  /// Opens the ring passed by the GUI when it spawned this process.
+  bool OpenFromEnvironment()
+  {
+    const char* fd_string = getenv("VISION_FRAME_RING_FD");
+
+    if (!fd_string)
+      return false;
+
+    return Open(atoi(fd_string));
+  }
+
+  /// Maps the ring and closes the file descriptor.
+  bool Open(int fd)
+  {
+    if ((fd < 0) || IsOpen())
+      return false;
+
+    struct stat info;
+
+    if ((fstat(fd, &info) != 0) || (size_t(info.st_size) <= 4096)) {
+      close(fd);
+      return false;
+    }
+
+    void* mapping = mmap(
+      nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    close(fd);
+
+    if (mapping == MAP_FAILED)
+      return false;
+
+    unsigned char* bytes = (unsigned char*)mapping;
+
+    if ((ReadLittleEndian<uint32_t>(bytes) != 0x4d485356) ||
+        (ReadLittleEndian<uint32_t>(bytes + 4) != 1)) {
+      munmap(mapping, info.st_size);
+      return false;
+    }
+
+    m_capacity = ReadLittleEndian<uint64_t>(bytes + 8);
+    m_consumed = (std::atomic<uint64_t>*)(bytes + 64);
+    m_data = bytes + 4096;
+
+    return true;
+  }
+
+  bool IsOpen() const { return m_data != nullptr; }
+
+  /// Waits until the GUI is done with enough of the ring to write the given
+  /// number of bytes.
+  ///
+  /// @return Where to write the bytes, or null if they do not fit.
+  unsigned char* Reserve(size_t size, uint64_t& position)
+  {
+    if (!m_data || (size > m_capacity))
+      return nullptr;
+
+    // Payloads do not wrap around the end of the ring.
+    if (((m_next % m_capacity) + size) > m_capacity)
+      m_next += m_capacity - (m_next % m_capacity);
+
+    while ((m_next + size - m_consumed->load(std::memory_order_acquire)) >
+           m_capacity)
+      usleep(100);
+
+    position = m_next;
+
+    m_next += size;
+
+    return m_data + (position % m_capacity);
+  }
+
+private:
+  template<typename Int>
+  static Int ReadLittleEndian(const unsigned char* data)
+  {
+    Int value = 0;
+
+    for (size_t i = 0; i < sizeof(Int); i++)
+      value |= Int(data[i]) << (i * 8);
+
+    return value;
+  }
+
+private:
+  unsigned char* m_data = nullptr;
+
+  uint64_t m_capacity = 0;
+
+  std::atomic<uint64_t>* m_consumed = nullptr;
+
+  uint64_t m_next = 0;
+};
+
+/// Reads commands from standard input or from a Unix domain socket. On a
+/// socket, the GUI may pass the shared frame ring along with the "f" command.
+/// When spawned by the GUI, there may also be an input channel for input
+/// events and control commands, which is read ahead of the other commands.
+class CommandReader final
+{
+public:
+  CommandReader(int fd)
+    : m_fd(fd)
+  {}
+
+  ~CommandReader()
+  {
+    if (m_received_fd >= 0)
+      close(m_received_fd);
 
+    if (m_input_fd >= 0)
+      close(m_input_fd);
+  }
+
+  /// Opens the input channel passed by the GUI when it spawned this process.
+  /// The GUI only starts using it once it is told that it is being read.
+  bool OpenInputChannelFromEnvironment()
+  {
+    const char* fd_string = getenv("VISION_INPUT_FD");
+
+    if (!fd_string)
+      return false;
+
+    const int fd = atoi(fd_string);
+
+    const char hello[] = "input\n";
+
+    if (write(fd, hello, sizeof(hello) - 1) != ssize_t(sizeof(hello) - 1)) {
+      close(fd);
+      return false;
+    }
+
+    m_input_fd = fd;
+
+    return true;
+  }
+
+  /// @return True if a command can be read without waiting.
+  bool IsReady()
+  {
+    if ((m_input_pending.find('\n') != std::string::npos) ||
+        (m_pending.find('\n') != std::string::npos))
+      return true;
+
+    pollfd poll_fds[2]{ { m_fd, POLLIN, 0 }, { m_input_fd, POLLIN, 0 } };
+
+    return poll(poll_fds, (m_input_fd >= 0) ? 2 : 1, 0) > 0;
+  }
+
+  bool ReadLine(std::string& line)
+  {
+    for (;;) {
+
+      if (TakeLine(m_input_pending, line))
+        return true;
+
+      // Input that arrived in the meantime goes ahead of the other commands.
+      if (ReadInputChannel(0))
+        continue;
+
+      if (TakeLine(m_pending, line))
+        return true;
+
+      if (!Wait())
+        return false;
+    }
+  }
+
+  /// @return The last file descriptor received with a command, or -1.
+  int TakeReceivedFd()
+  {
+    const int fd = m_received_fd;
+
+    m_received_fd = -1;
+
+    return fd;
+  }
+
+private:
+  ssize_t Receive(char* buffer, size_t size)
+  {
+    iovec io{ buffer, size };
+
+    union
+    {
+      char buffer[CMSG_SPACE(sizeof(int))];
+      cmsghdr align;
+    } control;
+
+    msghdr message{};
+    message.msg_iov = &io;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+
+    const ssize_t read_size = recvmsg(m_fd, &message, 0);
+
+    // Standard input is usually a pipe rather than a socket.
+    if ((read_size < 0) && (errno == ENOTSOCK))
+      return read(m_fd, buffer, size);
+
+    cmsghdr* header = CMSG_FIRSTHDR(&message);
+
+    if ((read_size > 0) && header && (header->cmsg_level == SOL_SOCKET) &&
+        (header->cmsg_type == SCM_RIGHTS)) {
+
+      TakeReceivedFd();
+
+      memcpy(&m_received_fd, CMSG_DATA(header), sizeof(int));
+    }
+
+    return read_size;
+  }
+
+  static bool TakeLine(std::string& pending, std::string& line)
+  {
+    const size_t newline = pending.find('\n');
+
+    if (newline == std::string::npos)
+      return false;
+
+    line = pending.substr(0, newline);
+
+    pending.erase(0, newline + 1);
+
+    return true;
+  }
+
+  /// @return True if anything was read from the input channel.
+  bool ReadInputChannel(int timeout)
+  {
+    if (m_input_fd < 0)
+      return false;
+
+    pollfd poll_fd{ m_input_fd, POLLIN, 0 };
+
+    if (poll(&poll_fd, 1, timeout) <= 0)
+      return false;
+
+    char buffer[4096];
+
+    const ssize_t read_size = read(m_input_fd, buffer, sizeof(buffer));
+
+    if (read_size <= 0) {
+      // The GUI closed the input channel, which leaves the other commands.
+      close(m_input_fd);
+      m_input_fd = -1;
+      return false;
+    }
+
+    m_input_pending.append(buffer, size_t(read_size));
+
+    return true;
+  }
+
+  /// Waits until either of the channels has something to read, and reads it.
+  ///
+  /// @return False once the GUI closed the command stream.
+  bool Wait()
+  {
+    pollfd poll_fds[2]{ { m_fd, POLLIN, 0 }, { m_input_fd, POLLIN, 0 } };
+
+    if (poll(poll_fds, (m_input_fd >= 0) ? 2 : 1, -1) < 0)
+      return errno == EINTR;
+
+    if (poll_fds[1].revents)
+      ReadInputChannel(0);
+
+    if (!poll_fds[0].revents)
+      return true;
+
+    char buffer[4096];
+
+    const ssize_t read_size = Receive(buffer, sizeof(buffer));
+
+    if (read_size <= 0)
+      return false;
+
+    m_pending.append(buffer, size_t(read_size));
+
+    return true;
+  }
+
+private:
+  int m_fd;
+
+  int m_received_fd = -1;
+
+  std::string m_pending;
+
+  /// The input channel, or -1 if there is none.
+  int m_input_fd = -1;
+
+  std::string m_input_pending;
+};
+
+#else
+
+/// Shared memory is only passed to renderers on Linux.
+class FrameRing final
+{
+public:
+  bool OpenFromEnvironment() { return false; }
+
+  bool Open(int) { return false; }
+
+  bool IsOpen() const { return false; }
+
+  unsigned char* Reserve(size_t, uint64_t&) { return nullptr; }
+};
+
+class CommandReader final
+{
+public:
+  CommandReader(int) {}
+
+  bool OpenInputChannelFromEnvironment() { return false; }
+
+  bool IsReady() { return false; }
+
+  bool ReadLine(std::string& line)
+  {
+    return bool(std::getline(std::cin, line));
+  }
+
+  int TakeReceivedFd() { return -1; }
+};
+
+#endif
+
+/// A render request that was received but not rendered yet.
+struct PendingRequest final
+{
+  int x_pixel_count = 0;
+  int y_pixel_count = 0;
+  int x_pixel_offset = 0;
+  int y_pixel_offset = 0;
+  int x_pixel_stride = 0;
+  int y_pixel_stride = 0;
+  int id = 0;
+
+  /// The frame size at the time of the request.
+  int w = 0;
+  int h = 0;
+};
+
+void
+Render(const PendingRequest& req, bool binary_protocol, FrameRing& frame_ring)
+{
+  const size_t buffer_size = size_t(req.x_pixel_count) * req.y_pixel_count * 3;
+
+  std::vector<unsigned char> buffer;
+
+  uint64_t ring_position = 0;
+
+  unsigned char* pixels = nullptr;
+
+  if (binary_protocol && frame_ring.IsOpen())
+    pixels = frame_ring.Reserve(buffer_size, ring_position);
+
+  if (!pixels) {
+    buffer.resize(buffer_size);
+    pixels = buffer.data();
+  }
+
+  for (int y = 0; y < req.y_pixel_count; y++) {
+
+    for (int x = 0; x < req.x_pixel_count; x++) {
+
+      const int abs_x = (x * req.x_pixel_stride) + req.x_pixel_offset;
+      const int abs_y = (y * req.y_pixel_stride) + req.y_pixel_offset;
+
+      const float u = (abs_x + 0.5f) / req.w;
+      const float v = (abs_y + 0.5f) / req.h;
+
+      unsigned char* pixel = &pixels[((y * req.x_pixel_count) + x) * 3];
+      pixel[0] = 255 * u;
+      pixel[1] = 255 * v;
+      pixel[2] = 255;
+    }
+  }
+
+  if (buffer.empty()) {
+    WriteSharedFrame(
+      req.x_pixel_count, req.y_pixel_count, req.id, ring_position);
+  } else if (binary_protocol) {
+    WriteFrameHeader(req.x_pixel_count, req.y_pixel_count, req.id);
+  } else {
+    printf(
+      "rgb buffer %d %d %d\n", req.x_pixel_count, req.y_pixel_count, req.id);
+  }
+
+  if (!buffer.empty())
+    fwrite(buffer.data(), 1, buffer.size(), stdout);
+
+  // Shared frames are small, so they would otherwise sit in the buffer.
+  fflush(stdout);
+}
+
+/// Handles the commands of one connection to the GUI, until it quits or the
+/// connection is closed. Render requests are queued and only rendered once
+/// no more commands are waiting, so that a cancel command can drop requests
+/// that were not rendered yet.
+void
+Serve(CommandReader& command_reader, FrameRing& frame_ring)
+{
   int w = 0;
   int h = 0;
   int padded_w = 0;
   int padded_h = 0;
 
-  int render_x_pixel_count = 0;
-  int render_y_pixel_count = 0;
-  int render_x_pixel_offset = 0;
-  int render_y_pixel_offset = 0;
-  int render_x_pixel_stride = 0;
-  int render_y_pixel_stride = 0;
-  int render_request_id = 0;
+  int protocol_version = 0;
+
+  bool binary_protocol = false;
+
+  std::deque<PendingRequest> pending_requests;
+
+  // Cancel commands may arrive through the input channel before the requests
+  // they cancel, so the requests are also checked as they arrive.
+  int first_current_id = 0;
+
+  std::string command;
 
-  while (std::cin) {
+  for (;;) {
 
-    std::string command;
+    if (!pending_requests.empty() && !command_reader.IsReady()) {
 
-    std::getline(std::cin, command);
+      Render(pending_requests.front(), binary_protocol, frame_ring);
+
+      pending_requests.pop_front();
+
+      continue;
+    }
+
+    if (!command_reader.ReadLine(command)) {
+      // The GUI closed its end, but still reads what was requested before.
+      for (const PendingRequest& req : pending_requests)
+        Render(req, binary_protocol, frame_ring);
+      break;
+    }
 
     if (command.empty() || (command == "q"))
       break;
 
+    PendingRequest req;
+
     switch (command[0]) {
       case 'r':
         sscanf(&command[1],
                "%d %d  %d %d  %d %d  %d",
-               &render_x_pixel_count,
-               &render_y_pixel_count,
-               &render_x_pixel_offset,
-               &render_y_pixel_offset,
-               &render_x_pixel_stride,
-               &render_y_pixel_stride,
-               &render_request_id);
+               &req.x_pixel_count,
+               &req.y_pixel_count,
+               &req.x_pixel_offset,
+               &req.y_pixel_offset,
+               &req.x_pixel_stride,
+               &req.y_pixel_stride,
+               &req.id);
+        req.w = w;
+        req.h = h;
+        if (req.id >= first_current_id)
+          pending_requests.emplace_back(req);
+        break;
+      case 'c': // <- cancel the requests before the given ID
+        sscanf(&command[1], "%d", &first_current_id);
+        while (!pending_requests.empty() &&
+               (pending_requests.front().id < first_current_id))
+          pending_requests.pop_front();
         break;
       case 's':
         sscanf(&command[1], "%d %d %d %d", &w, &h, &padded_w, &padded_h);
         break;
+      case 'p': // <- protocol version offered by the GUI
+        sscanf(&command[1], "%d", &protocol_version);
+        if (protocol_version == 2) {
+          printf("protocol 2\n");
+          fflush(stdout);
+          binary_protocol = true;
+        }
+        break;
       case 'k': // <- keyboard input
         break;
-      case 'm': // <- mouse movement input
+      case 'm': // <- mouse movement input (x, y, dx, dy)
         break;
       case 'b': // <- mouse button input
         break;
+      case 'f': // <- shared frame ring, passed over a Unix domain socket
+        frame_ring.Open(command_reader.TakeReceivedFd());
+        break;
     }
+  }
+}
 
-    if (command[0] != 'r')
-      continue;
+#ifdef __linux__
 
-    std::vector<unsigned char> buffer(render_x_pixel_count *
-                                      render_y_pixel_count * 3);
+/// Listens on a Unix domain socket and serves one GUI at a time, so that the
+/// GUI can attach to this process again without it having to start over.
+int
+Listen(const char* path)
+{
+  const int server = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
 
-    for (int y = 0; y < render_y_pixel_count; y++) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
 
-      for (int x = 0; x < render_x_pixel_count; x++) {
+  unlink(path);
 
-        const int abs_x = (x * render_x_pixel_stride) + render_x_pixel_offset;
-        const int abs_y = (y * render_y_pixel_stride) + render_y_pixel_offset;
+  if ((server < 0) ||
+      (bind(server, (const sockaddr*)&address, sizeof(address)) != 0) ||
+      (listen(server, 1) != 0)) {
+    perror("Failed to listen");
+    return EXIT_FAILURE;
+  }
 
-        const float u = (abs_x + 0.5f) / w;
-        const float v = (abs_y + 0.5f) / h;
+  // A GUI that disconnects should not end the process.
+  signal(SIGPIPE, SIG_IGN);
 
-        unsigned char* pixel = &buffer[((y * render_x_pixel_count) + x) * 3];
-        pixel[0] = 255 * u;
-        pixel[1] = 255 * v;
-        pixel[2] = 255;
-      }
-    }
+  for (;;) {
+
+    const int connection = accept4(server, nullptr, nullptr, SOCK_CLOEXEC);
+
+    if (connection < 0)
+      continue;
+
+    dup2(connection, STDOUT_FILENO);
+
+    clearerr(stdout);
+
+    CommandReader command_reader(connection);
+
+    FrameRing frame_ring;
 
-    printf("rgb buffer %d %d %d\n",
-           render_x_pixel_count,
-           render_y_pixel_count,
-           render_request_id);
+    Serve(command_reader, frame_ring);
 
-    fwrite(&buffer[0], 1, buffer.size(), stdout);
+    fflush(stdout);
+
+    close(connection);
   }
+}
+
+#endif
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+#ifdef __linux__
+  if ((argc == 3) && (std::string(argv[1]) == "--listen"))
+    return Listen(argv[2]);
+#else
+  (void)argc;
+  (void)argv;
+#endif
+
+  CommandReader command_reader(0);
+
+  command_reader.OpenInputChannelFromEnvironment();
+
+  FrameRing frame_ring;
+
+  frame_ring.OpenFromEnvironment();
+
+  Serve(command_reader, frame_ring);
 
   return EXIT_SUCCESS;
 }
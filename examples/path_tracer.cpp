@@ -387,7 +387,7 @@ main()
         break;
       case 'k': // <- keyboard input
         break;
-      case 'm': // <- mouse movement input
+      case 'm': // <- mouse movement input (x, y, dx, dy)
         break;
       case 'b': // <- mouse button input
         break;
@@ -70,6 +70,7 @@ AddressBar::AddressBar(QWidget* parent)
 
   m_address_kind_box.addItem("tcp", QString("tcp"));
   m_address_kind_box.addItem("program", QString("file"));
+  m_address_kind_box.addItem("unix", QString("unix"));
 
   m_menu_button.setMenu(&m_menu);
 
@@ -124,6 +125,9 @@ AddressBar::HandleModeSwitch(int index)
     case AddressKind::Tcp:
       ToTcpMode();
       break;
+    case AddressKind::Unix:
+      ToUnixMode();
+      break;
   }
 }
 
@@ -161,6 +165,8 @@ AddressBar::GetAddressKind(const QString& kind)
     return AddressKind::File;
   else if (kind == "debug")
     return AddressKind::Debug;
+  else if (kind == "unix")
+    return AddressKind::Unix;
 
   return AddressKind::Unknown;
 }
@@ -171,6 +177,12 @@ AddressBar::ToTcpMode()
   SwitchMode(&m_tcp_item_model, "Enter an address to connect to.");
 }
 
+void
+AddressBar::ToUnixMode()
+{
+  SwitchMode(&m_unix_item_model, "Enter the socket path of a renderer.");
+}
+
 void
 AddressBar::ToFileMode()
 {
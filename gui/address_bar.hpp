@@ -20,7 +20,9 @@ enum class AddressKind
   Unknown,
   Debug,
   File,
-  Tcp
+  Tcp,
+  /// A renderer that is already listening on a Unix domain socket.
+  Unix
 };
 
 struct Address final
@@ -41,6 +43,8 @@ private:
 
   void ToTcpMode();
 
+  void ToUnixMode();
+
   void ToFileMode();
 
   void ToDebugMode();
@@ -83,6 +87,8 @@ private:
 
   QStringListModel m_tcp_item_model{ this };
 
+  QStringListModel m_unix_item_model{ this };
+
   QMenu m_menu{ this };
 
   std::vector<Address> m_history;
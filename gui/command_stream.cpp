@@ -4,138 +4,279 @@
 #include "resize_request.hpp"
 #include "schedule.hpp"
 
-#include <sstream>
-
 #include <QIODevice>
-#include <QString>
-
-#include <QDebug>
+#include <QTimer>
 
 namespace vision::gui {
 
 namespace {
 
+/// Once this many bytes of commands are buffered, they are written without
+/// waiting for the event loop.
+constexpr size_t command_flush_threshold = 16 * 1024;
+
+/// The most bytes that a single command can take, not counting the text of
+/// keys and mouse buttons.
+constexpr size_t max_command_size = 256;
+
+} // namespace
+
+CommandStream::CommandStream(QIODevice& io_device)
+  : m_io_device(io_device)
+  , m_flush_timer(new QTimer())
+{
+  m_buffer.reserve(command_flush_threshold + max_command_size);
+
+  m_flush_timer->setSingleShot(true);
+
+  m_flush_timer->setInterval(0);
+
+  QObject::connect(
+    m_flush_timer.get(), &QTimer::timeout, [this] { Flush(); });
+}
+
+CommandStream::~CommandStream() = default;
+
 void
-Flush(std::ostringstream& stream, QIODevice& io_device)
+CommandStream::Flush()
 {
-  const std::string data = stream.str();
+  m_flush_timer->stop();
+
+  if (m_buffer.empty())
+    return;
+
+  m_io_device.write(m_buffer.data(), qint64(m_buffer.size()));
 
-  io_device.write(&data[0], data.size());
+  // Keeps the capacity of the buffer.
+  m_buffer.clear();
 }
 
-} // namespace
+void
+CommandStream::EndCommand()
+{
+  if (m_buffer.size() >= command_flush_threshold)
+    Flush();
+  else if (!m_flush_timer->isActive())
+    m_flush_timer->start();
+}
 
 void
-CommandStream::SendAllRenderRequests(const Schedule& schedule)
+CommandStream::SendProtocolRequest(size_t version)
 {
-  qDebug() << "render";
+  Append("p ", 2);
+  AppendNumber(version);
+  Append('\n');
 
-  std::ostringstream stream;
+  EndCommand();
+}
 
-  const size_t req_count = schedule.GetRenderRequestCount();
+void
+CommandStream::QueueRenderRequests(const Schedule& schedule)
+{
+  // Request IDs only increase, so the first request of a frame separates it
+  // from the requests of previous frames.
+  if (schedule.GetRenderRequestCount() &&
+      m_request_window.GetOutstandingCount()) {
 
-  for (size_t i = 0; i < req_count; i++) {
+    const size_t first_id = schedule.GetRenderRequest(0).id;
 
-    const RenderRequest req = schedule.GetRenderRequest(i);
+    m_request_window.CancelBefore(first_id);
 
-    Write(stream, req);
+    SendCancel(first_id);
   }
 
-  qDebug() << "render: " << stream.str().c_str();
+  m_request_window.Queue(schedule);
 
-  Flush(stream, m_io_device);
+  SendQueuedRequests();
 }
 
 void
-CommandStream::SendRenderRequest(const RenderRequest& req)
+CommandStream::CompleteRenderRequest(size_t request_id)
 {
-  std::ostringstream stream;
+  m_request_window.Complete(request_id);
+}
 
-  Write(stream, req);
+void
+CommandStream::SendQueuedRequests()
+{
+  RenderRequest req;
 
-  Flush(stream, m_io_device);
+  while (m_request_window.TakeNext(req)) {
+    Append(req);
+    EndCommand();
+  }
 }
 
 void
-CommandStream::Write(std::ostream& output, const RenderRequest& req)
+CommandStream::SendRenderRequest(const RenderRequest& req)
 {
-  output << "r ";
-  output << req.x_pixel_count << ' ' << req.y_pixel_count;
-  output << ' ';
-  output << req.x_pixel_offset << ' ' << req.y_pixel_offset;
-  output << ' ';
-  output << req.y_pixel_stride << ' ' << req.y_pixel_stride;
-  output << ' ';
-  output << req.id << '\n';
+  Append(req);
+
+  EndCommand();
 }
 
 void
-CommandStream::SendResizeRequest(const ResizeRequest& req)
+CommandStream::SendCancel(size_t first_current_id)
 {
-  std::ostringstream stream;
+  if (m_control_stream) {
+    m_control_stream->SendCancel(first_current_id);
+    return;
+  }
 
-  stream << "s ";
+  Append("c ", 2);
+  AppendNumber(first_current_id);
+  Append('\n');
+
+  EndCommand();
+}
 
-  stream << req.width << ' ' << req.height;
+void
+CommandStream::Append(const RenderRequest& req)
+{
+  Append("r ", 2);
+  AppendNumber(req.x_pixel_count);
+  Append(' ');
+  AppendNumber(req.y_pixel_count);
+  Append(' ');
+  AppendNumber(req.x_pixel_offset);
+  Append(' ');
+  AppendNumber(req.y_pixel_offset);
+  Append(' ');
+  AppendNumber(req.x_pixel_stride);
+  Append(' ');
+  AppendNumber(req.y_pixel_stride);
+  Append(' ');
+  AppendNumber(req.id);
+  Append('\n');
+}
 
-  stream << ' ';
+void
+CommandStream::Append(const char* text, size_t size)
+{
+  m_buffer.append(text, size);
+}
 
-  stream << req.padded_width << ' ' << req.padded_height;
+void
+CommandStream::AppendNumber(size_t value)
+{
+  char digits[20];
 
-  qDebug() << "resize: " << stream.str().c_str();
+  size_t count = 0;
 
-  stream << '\n';
+  do {
+    digits[count++] = char('0' + (value % 10));
+    value /= 10;
+  } while (value > 0);
 
-  Flush(stream, m_io_device);
+  while (count > 0)
+    m_buffer.push_back(digits[--count]);
 }
 
 void
-CommandStream::SendKey(const QString& key, bool state)
+CommandStream::AppendNumber(int value)
 {
-  std::ostringstream stream;
-
-  stream << "k " << key.toStdString() << " " << int(state);
-
-  stream << '\n';
+  if (value < 0) {
+    Append('-');
+    // Negated as an unsigned value, so that the smallest int does not
+    // overflow.
+    AppendNumber(size_t(0) - size_t(value));
+  } else {
+    AppendNumber(size_t(value));
+  }
+}
 
-  Flush(stream, m_io_device);
+void
+CommandStream::SendResizeRequest(const ResizeRequest& req)
+{
+  Append("s ", 2);
+  AppendNumber(req.width);
+  Append(' ');
+  AppendNumber(req.height);
+  Append(' ');
+  AppendNumber(req.padded_width);
+  Append(' ');
+  AppendNumber(req.padded_height);
+  Append('\n');
+
+  EndCommand();
 }
 
 void
-CommandStream::SendMouseButton(const QString& button, int x, int y, bool state)
+CommandStream::SendKey(std::string_view key, bool state)
 {
-  std::ostringstream stream;
+  if (m_control_stream) {
+    m_control_stream->SendKey(key, state);
+    return;
+  }
 
-  stream << "b ";
-  stream << button.toStdString();
-  stream << ' ';
-  stream << x << ' ' << y;
-  stream << ' ' << int(state);
-  stream << '\n';
+  Append("k ", 2);
+  Append(key);
+  Append(' ');
+  AppendNumber(int(state));
+  Append('\n');
 
-  Flush(stream, m_io_device);
+  EndCommand();
 }
 
 void
-CommandStream::SendMouseMove(int x, int y)
+CommandStream::SendMouseButton(std::string_view button,
+                               int x,
+                               int y,
+                               bool state)
 {
-  std::ostringstream stream;
+  if (m_control_stream) {
+    m_control_stream->SendMouseButton(button, x, y, state);
+    return;
+  }
 
-  stream << "m ";
-  stream << x << ' ' << y;
-  stream << '\n';
+  Append("b ", 2);
+  Append(button);
+  Append(' ');
+  AppendNumber(x);
+  Append(' ');
+  AppendNumber(y);
+  Append(' ');
+  AppendNumber(int(state));
+  Append('\n');
+
+  EndCommand();
+}
 
-  Flush(stream, m_io_device);
+void
+CommandStream::SendMouseMove(int x, int y, int dx, int dy)
+{
+  if (m_control_stream) {
+    m_control_stream->SendMouseMove(x, y, dx, dy);
+    return;
+  }
+
+  Append("m ", 2);
+  AppendNumber(x);
+  Append(' ');
+  AppendNumber(y);
+  Append(' ');
+  AppendNumber(dx);
+  Append(' ');
+  AppendNumber(dy);
+  Append('\n');
+
+  EndCommand();
 }
 
 void
 CommandStream::SendQuit()
 {
-  std::ostringstream stream;
+  // The commands buffered on this stream are not left behind.
+  Flush();
+
+  if (m_control_stream) {
+    m_control_stream->SendQuit();
+    return;
+  }
 
-  stream << "q\n";
+  Append("q\n", 2);
 
-  Flush(stream, m_io_device);
+  Flush();
 }
 
 } // namespace vision::gui
@@ -1,9 +1,15 @@
 #pragma once
 
-#include <iosfwd>
+#include "request_window.hpp"
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include <stddef.h>
 
 class QIODevice;
-class QString;
+class QTimer;
 
 namespace vision::gui {
 
@@ -12,32 +18,105 @@ struct ResizeRequest;
 
 class Schedule;
 
+/// Formats commands for the renderer. Commands are appended to a buffer that
+/// is written to the device once per turn of the event loop, or as soon as it
+/// grows past a threshold, so that a burst of events leads to a single write.
+/// The buffer is allocated once, so sending a command does not allocate.
 class CommandStream final
 {
 public:
-  CommandStream(QIODevice& io_device)
-    : m_io_device(io_device)
-  {}
+  CommandStream(QIODevice& io_device);
+
+  CommandStream(const CommandStream&) = delete;
+
+  CommandStream& operator=(const CommandStream&) = delete;
+
+  /// Commands that are still buffered are dropped, since the device may
+  /// already be closed by the time the stream is destroyed.
+  ~CommandStream();
+
+  /// Writes the buffered commands to the device now, instead of waiting for
+  /// the next turn of the event loop.
+  void Flush();
 
-  void SendAllRenderRequests(const Schedule&);
+  /// Sends the input events, and the cancel and quit commands, through another
+  /// stream, so that they are not held up behind render requests. Pass null to
+  /// send them through this stream again.
+  void SetControlStream(CommandStream* control_stream)
+  {
+    m_control_stream = control_stream;
+  }
+
+  /// Offers the renderer a protocol version to switch to. Renderers that
+  /// support it reply with a "protocol" line, while other renderers ignore it.
+  void SendProtocolRequest(size_t version);
+
+  /// Queues the render requests of a new frame, replacing the requests of the
+  /// previous frame that were not sent yet, and sends as many of them as the
+  /// request window allows. If requests of a previous frame are outstanding,
+  /// the renderer is first asked to cancel them.
+  void QueueRenderRequests(const Schedule&);
+
+  /// Returns the credit of a render request whose reply arrived. The requests
+  /// that can be sent as a result are only sent by @ref SendQueuedRequests, so
+  /// that a batch of replies leads to a single write.
+  void CompleteRenderRequest(size_t request_id);
+
+  /// Sends the queued render requests that fit in the request window.
+  void SendQueuedRequests();
+
+  RequestWindow& GetRequestWindow() noexcept { return m_request_window; }
 
   void SendRenderRequest(const RenderRequest&);
 
+  /// Asks the renderer to drop every render request with an ID below the
+  /// given one. Renderers that do not support this ignore it, in which case
+  /// the replies are still sent and skipped as they arrive.
+  void SendCancel(size_t first_current_id);
+
   void SendResizeRequest(const ResizeRequest&);
 
-  void SendKey(const QString& key, bool state);
+  void SendKey(std::string_view key, bool state);
 
-  void SendMouseButton(const QString& button, int x, int y, bool state);
+  void SendMouseButton(std::string_view button, int x, int y, bool state);
 
-  void SendMouseMove(int x, int y);
+  /// Sends the position of the mouse, along with how far it moved since the
+  /// last mouse event that was sent.
+  void SendMouseMove(int x, int y, int dx, int dy);
 
+  /// Sends the quit command, along with any buffered commands, right away.
   void SendQuit();
 
-protected:
-  void Write(std::ostream& output_stream, const RenderRequest&);
+private:
+  void Append(const RenderRequest&);
+
+  void Append(const char* text, size_t size);
+
+  void Append(std::string_view text) { Append(text.data(), text.size()); }
+
+  void Append(char c) { m_buffer.push_back(c); }
+
+  void AppendNumber(size_t value);
+
+  void AppendNumber(int value);
+
+  /// Called after each command, to either write the buffer or make sure that
+  /// it gets written on the next turn of the event loop.
+  void EndCommand();
 
 private:
   QIODevice& m_io_device;
+
+  RequestWindow m_request_window;
+
+  /// The commands that have not been written yet.
+  std::string m_buffer;
+
+  /// Writes the buffer on the next turn of the event loop.
+  std::unique_ptr<QTimer> m_flush_timer;
+
+  /// Where the input events and control commands are sent, if not here.
+  CommandStream* m_control_stream = nullptr;
 };
 
 } // namespace vision::gui
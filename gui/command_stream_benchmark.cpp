@@ -0,0 +1,181 @@
+#include <benchmark/benchmark.h>
+
+#include "command_stream.hpp"
+#include "render_request.hpp"
+
+#include <QCoreApplication>
+#include <QIODevice>
+
+#include <sstream>
+#include <string>
+
+using namespace vision::gui;
+
+namespace {
+
+/// Counts the writes made to it and discards the data.
+class NullDevice final : public QIODevice
+{
+public:
+  NullDevice() { open(QIODevice::WriteOnly | QIODevice::Unbuffered); }
+
+  bool isSequential() const override { return true; }
+
+  size_t GetWriteCount() const noexcept { return m_write_count; }
+
+protected:
+  qint64 readData(char*, qint64) override { return -1; }
+
+  qint64 writeData(const char*, qint64 size) override
+  {
+    m_write_count++;
+
+    return size;
+  }
+
+private:
+  size_t m_write_count = 0;
+};
+
+/// The command stream starts a timer for flushing, which needs an application
+/// object to exist. The event loop is never run, so only the size threshold
+/// causes writes.
+void
+MakeApplication()
+{
+  static int argc = 1;
+
+  static char name[] = "run_benchmarks";
+
+  static char* argv[] = { name, nullptr };
+
+  static QCoreApplication application(argc, argv);
+}
+
+/// How commands were sent before they were buffered, for comparison.
+void
+Flush(std::ostringstream& stream, QIODevice& io_device)
+{
+  const std::string data = stream.str();
+
+  io_device.write(&data[0], data.size());
+}
+
+void
+LegacySendMouseMove(QIODevice& io_device, int x, int y)
+{
+  std::ostringstream stream;
+
+  stream << "m ";
+  stream << x << ' ' << y;
+  stream << '\n';
+
+  Flush(stream, io_device);
+}
+
+void
+LegacySendRenderRequest(QIODevice& io_device, const RenderRequest& req)
+{
+  std::ostringstream stream;
+
+  stream << "r ";
+  stream << req.x_pixel_count << ' ' << req.y_pixel_count;
+  stream << ' ';
+  stream << req.x_pixel_offset << ' ' << req.y_pixel_offset;
+  stream << ' ';
+  stream << req.x_pixel_stride << ' ' << req.y_pixel_stride;
+  stream << ' ';
+  stream << req.id << '\n';
+
+  Flush(stream, io_device);
+}
+
+RenderRequest
+MakeRenderRequest(size_t id)
+{
+  return RenderRequest{ id, 239, 134, 3, 5, 8, 8, 1920, 1080 };
+}
+
+void
+SetCounters(benchmark::State& state, const NullDevice& device)
+{
+  state.counters["commands_per_second"] =
+    benchmark::Counter(double(state.iterations()), benchmark::Counter::kIsRate);
+
+  state.counters["writes_per_command"] = benchmark::Counter(
+    double(device.GetWriteCount()), benchmark::Counter::kAvgIterations);
+}
+
+void
+BM_CommandStream_MouseMove_Legacy(benchmark::State& state)
+{
+  NullDevice device;
+
+  int x = 0;
+
+  for (auto _ : state)
+    LegacySendMouseMove(device, (x++) & 1023, 512);
+
+  SetCounters(state, device);
+}
+
+void
+BM_CommandStream_MouseMove(benchmark::State& state)
+{
+  MakeApplication();
+
+  NullDevice device;
+
+  CommandStream command_stream(device);
+
+  int x = 0;
+
+  for (auto _ : state)
+    command_stream.SendMouseMove((x++) & 1023, 512, 1, 0);
+
+  command_stream.Flush();
+
+  SetCounters(state, device);
+}
+
+void
+BM_CommandStream_RenderRequest_Legacy(benchmark::State& state)
+{
+  NullDevice device;
+
+  size_t id = 0;
+
+  for (auto _ : state)
+    LegacySendRenderRequest(device, MakeRenderRequest(id++));
+
+  SetCounters(state, device);
+}
+
+void
+BM_CommandStream_RenderRequest(benchmark::State& state)
+{
+  MakeApplication();
+
+  NullDevice device;
+
+  CommandStream command_stream(device);
+
+  size_t id = 0;
+
+  for (auto _ : state)
+    command_stream.SendRenderRequest(MakeRenderRequest(id++));
+
+  command_stream.Flush();
+
+  SetCounters(state, device);
+}
+
+BENCHMARK(BM_CommandStream_MouseMove_Legacy);
+
+BENCHMARK(BM_CommandStream_MouseMove);
+
+BENCHMARK(BM_CommandStream_RenderRequest_Legacy);
+
+BENCHMARK(BM_CommandStream_RenderRequest);
+
+} // namespace
@@ -1,34 +1,119 @@
 #include "content_view.hpp"
 
 #include "command_stream.hpp"
+#include "input_coalescer.hpp"
+#include "monitor.hpp"
 #include "render_request.hpp"
 #include "resize_request.hpp"
-#include "response.hpp"
-#include "response_signal_emitter.hpp"
+#include "response_decoder.hpp"
+#include "response_worker.hpp"
+#include "schedule.hpp"
 #include "view.hpp"
 
 #include <QTabWidget>
+#include <QTimer>
 #include <QVBoxLayout>
 
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#endif
+
 namespace vision::gui {
 
 namespace {
 
-class ViewEventStreamer final : public ViewObserver
+/// How often the input events are sent to the renderer, in milliseconds, when
+/// the renderer is not replying to render requests.
+constexpr int default_input_flush_interval = 8;
+
+class ViewEventStreamer final
+  : public ViewObserver
+  , public InputSink
 {
 public:
-  ViewEventStreamer(QIODevice& io_device)
+  ViewEventStreamer(QIODevice& io_device, ResponseWorker& response_worker)
     : m_command_stream(io_device)
-  {}
+    , m_response_worker(response_worker)
+  {
+    m_input_timer.setSingleShot(true);
+
+    m_input_timer.setInterval(default_input_flush_interval);
+
+    QObject::connect(
+      &m_input_timer, &QTimer::timeout, [this] { FlushInput(); });
+  }
 
   void SetEnabled(bool enabled) { m_enabled = enabled; }
 
+  void SetInputFlushInterval(int milliseconds)
+  {
+    m_input_timer.setInterval(milliseconds);
+  }
+
+  /// Sends the input events and control commands through their own device.
+  void SetInputDevice(QIODevice& io_device)
+  {
+    m_command_stream.SetControlStream(nullptr);
+
+    m_input_stream.reset(new CommandStream(io_device));
+
+    m_command_stream.SetControlStream(m_input_stream.get());
+  }
+
   void OnNewFrame(const Schedule& schedule) override
   {
-    if (m_enabled)
-      m_command_stream.SendAllRenderRequests(schedule);
+    if (!m_enabled)
+      return;
+
+    // Replies to the previous frames are skipped from here on, even if they
+    // were sent before the renderer got the cancel command.
+    if (schedule.GetRenderRequestCount()) {
+      const size_t first_id = schedule.GetRenderRequest(0).id;
+      m_response_worker.SetFirstCurrentRequest(first_id);
+    }
+
+    m_command_stream.QueueRenderRequests(schedule);
   }
 
+  /// Issues the next render requests once replies have arrived.
+  void OnRenderRequestReplies(const RenderRequestReply* replies, size_t count)
+  {
+    if (!m_enabled)
+      return;
+
+    for (size_t i = 0; i < count; i++)
+      m_command_stream.CompleteRenderRequest(replies[i].request_id);
+
+    // The renderer is ready for more, so the input it has not seen yet goes
+    // ahead of the next render requests.
+    FlushInput();
+
+    m_command_stream.SendQueuedRequests();
+  }
+
+  /// Issues the outstanding requests again, since their replies may have
+  /// been dropped along with invalid input.
+  void OnRepliesLost()
+  {
+    if (!m_enabled)
+      return;
+
+    m_command_stream.GetRequestWindow().Reissue();
+
+    m_command_stream.SendQueuedRequests();
+  }
+
+  RequestWindow& GetRequestWindow()
+  {
+    return m_command_stream.GetRequestWindow();
+  }
+
+  CommandStream& GetCommandStream() { return m_command_stream; }
+
   void OnResize(size_t w, size_t h, size_t padded_w, size_t padded_h) override
   {
     if (m_enabled) {
@@ -41,8 +126,12 @@ public:
 
   void OnKeyEvent(const QString& key, bool state) override
   {
-    if (m_enabled)
-      m_command_stream.SendKey(key, state);
+    if (!m_enabled)
+      return;
+
+    m_input.AddKey(key.toStdString(), state);
+
+    ScheduleInputFlush();
   }
 
   void OnMouseButtonEvent(const QString& button,
@@ -50,19 +139,75 @@ public:
                           int y,
                           bool state) override
   {
-    if (m_enabled)
-      m_command_stream.SendMouseButton(button, x, y, state);
+    if (!m_enabled)
+      return;
+
+    m_input.AddMouseButton(button.toStdString(), x, y, state);
+
+    ScheduleInputFlush();
   }
 
   void OnMouseMoveEvent(int x, int y) override
   {
-    if (m_enabled)
-      m_command_stream.SendMouseMove(x, y);
+    if (!m_enabled)
+      return;
+
+    m_input.AddMouseMove(x, y);
+
+    ScheduleInputFlush();
+  }
+
+  void OnKey(std::string_view key, bool state) override
+  {
+    m_command_stream.SendKey(key, state);
+  }
+
+  void OnMouseButton(std::string_view button,
+                     int x,
+                     int y,
+                     bool state) override
+  {
+    m_command_stream.SendMouseButton(button, x, y, state);
+  }
+
+  void OnMouseMove(int x, int y, int dx, int dy) override
+  {
+    m_command_stream.SendMouseMove(x, y, dx, dy);
+  }
+
+private:
+  void ScheduleInputFlush()
+  {
+    if (!m_input_timer.isActive())
+      m_input_timer.start();
+  }
+
+  void FlushInput()
+  {
+    m_input_timer.stop();
+
+    m_input.Flush(*this);
+
+    // The input channel only carries small commands, so they are written
+    // right away.
+    if (m_input_stream)
+      m_input_stream->Flush();
   }
 
 private:
   CommandStream m_command_stream;
 
+  /// The input events that have not been sent yet.
+  InputCoalescer m_input;
+
+  /// Sends the input events at a bounded rate.
+  QTimer m_input_timer;
+
+  /// The stream of the input channel, if the renderer has one.
+  std::unique_ptr<CommandStream> m_input_stream;
+
+  ResponseWorker& m_response_worker;
+
   bool m_enabled = false;
 };
 
@@ -77,8 +222,9 @@ class ContentViewImpl final
     , m_view(CreateView(self))
     , m_layout(self)
     , m_tool_tabs(self)
-    , m_response_signal_emitter(self)
-    , m_view_event_streamer(*io_device)
+    , m_monitor(CreateMonitor(self))
+    , m_response_worker(self)
+    , m_view_event_streamer(*io_device, m_response_worker)
   {
     m_layout.addWidget(m_view);
 
@@ -93,38 +239,45 @@ class ContentViewImpl final
 
   QTabWidget m_tool_tabs;
 
-  ResponseSignalEmitter m_response_signal_emitter;
+  Monitor* m_monitor;
+
+  ResponseWorker m_response_worker;
 
   ViewEventStreamer m_view_event_streamer;
 
-  std::unique_ptr<ResponseParser> m_response_parser =
-    ResponseParser::Create(m_response_signal_emitter);
+  /// Reused between batches of replies to avoid reallocating.
+  std::vector<RenderRequestReply> m_replies;
+
+  /// Keeps the partitions of a batch alive until they are uploaded.
+  std::vector<std::unique_ptr<const PartitionBuffer>> m_partitions;
 };
 
 ContentView::ContentView(QWidget* parent, QIODevice* io_device)
   : QWidget(parent)
   , m_impl(new ContentViewImpl(this, io_device))
 {
-  connect(&m_impl->m_response_signal_emitter,
-          &ResponseSignalEmitter::InvalidResponse,
-          this,
-          &ContentView::InvalidResponse);
-
-  connect(&m_impl->m_response_signal_emitter,
-          &ResponseSignalEmitter::BufferOverflow,
+  connect(&m_impl->m_response_worker,
+          &ResponseWorker::ResponsesAvailable,
           this,
-          &ContentView::BufferOverflow);
+          &ContentView::HandleDecodedResponses);
 
-  connect(&m_impl->m_response_signal_emitter,
-          &ResponseSignalEmitter::RGBBuffer,
+  connect(&m_impl->m_response_worker,
+          &ResponseWorker::EndOfStream,
           this,
-          &ContentView::ForwardRGBBuffer);
+          &ContentView::HandleEndOfStream);
 
   m_impl->m_view->SetObserver(&m_impl->m_view_event_streamer);
+
+  m_impl->m_view->SetStagingPool(&m_impl->m_response_worker.GetStagingPool());
+
+  AddToolTab("Monitor", m_impl->m_monitor);
 }
 
 ContentView::~ContentView()
 {
+  // The view outlives the worker, which owns the pool.
+  m_impl->m_view->SetStagingPool(nullptr);
+
   delete m_impl;
 }
 
@@ -141,7 +294,12 @@ ContentView::BeginRendering()
 
   const ResizeRequest req = m_impl->m_view->MakeResizeRequest();
 
-  CommandStream command_stream(*GetIODevice());
+  // The same stream as the view events, so that these commands are written
+  // before the render requests of the first frame.
+  CommandStream& command_stream =
+    m_impl->m_view_event_streamer.GetCommandStream();
+
+  command_stream.SendProtocolRequest(2);
 
   command_stream.SendResizeRequest(req);
 
@@ -149,17 +307,80 @@ ContentView::BeginRendering()
 }
 
 void
-ContentView::SendQuitCommand()
+ContentView::SetRequestWindow(size_t max_requests, size_t max_bytes)
 {
-  CommandStream command_stream(*GetIODevice());
+  RequestWindow& window = m_impl->m_view_event_streamer.GetRequestWindow();
 
-  command_stream.SendQuit();
+  window.SetLimits(max_requests, max_bytes);
+}
+
+void
+ContentView::SetInputFlushInterval(int milliseconds)
+{
+  m_impl->m_view_event_streamer.SetInputFlushInterval(milliseconds);
+}
+
+void
+ContentView::SetAccumulationEnabled(bool enabled)
+{
+  m_impl->m_view->SetAccumulationEnabled(enabled);
+}
+
+void
+ContentView::SetTileSize(size_t tile_size)
+{
+  m_impl->m_view->SetTileSize(tile_size);
+}
+
+void
+ContentView::SetInputDevice(QIODevice* io_device)
+{
+  m_impl->m_view_event_streamer.SetInputDevice(*io_device);
+}
+
+void
+ContentView::SendQuitCommand()
+{
+  m_impl->m_view_event_streamer.GetCommandStream().SendQuit();
 }
 
 void
 ContentView::HandleIncomingData(const QByteArray& data)
 {
-  m_impl->m_response_parser->Write(data.constData(), data.size());
+  m_impl->m_response_worker.Write(data);
+}
+
+bool
+ContentView::ReadFileDescriptor(int fd)
+{
+  return m_impl->m_response_worker.Read(fd);
+}
+
+bool
+ContentView::ReadSocketDescriptor(qintptr descriptor)
+{
+#ifdef __linux__
+  if (descriptor < 0)
+    return false;
+
+  const int fd = ::fcntl(int(descriptor), F_DUPFD_CLOEXEC, 0);
+
+  if (fd < 0)
+    return false;
+
+  return ReadFileDescriptor(fd);
+#else
+  (void)descriptor;
+
+  return false;
+#endif
+}
+
+void
+ContentView::SetSharedPayloadSource(
+  std::unique_ptr<SharedPayloadSource> source)
+{
+  m_impl->m_response_worker.SetSharedPayloadSource(std::move(source));
 }
 
 void
@@ -171,12 +392,108 @@ ContentView::ReadIODevice()
 }
 
 void
-ContentView::ForwardRGBBuffer(const unsigned char* buffer,
-                              size_t w,
-                              size_t h,
-                              size_t req_id)
+ContentView::HandleDecodedResponses()
+{
+  std::vector<RenderRequestReply>& replies = m_impl->m_replies;
+
+  std::vector<std::unique_ptr<const PartitionBuffer>>& partitions =
+    m_impl->m_partitions;
+
+  m_impl->m_monitor->LogConnectionRead(
+    m_impl->m_response_worker.TakeBytesReceived());
+
+  DecodedResponse response;
+
+  while (m_impl->m_response_worker.TryPop(response)) {
+
+    if (response.kind == DecodedResponse::Kind::InvalidResponse) {
+      UploadReplies();
+      m_impl->m_view_event_streamer.OnRepliesLost();
+      emit InvalidResponse(QString::fromStdString(response.reason));
+      continue;
+    } else if (response.kind == DecodedResponse::Kind::BufferOverflow) {
+      UploadReplies();
+      m_impl->m_view_event_streamer.OnRepliesLost();
+      emit BufferOverflow(response.buffer_max);
+      continue;
+    }
+
+    const PartitionBuffer& partition = *response.partition;
+
+    if (response.kind == DecodedResponse::Kind::Rows) {
+      // The replies before the rows go first.
+      UploadReplies();
+      UploadRows(partition);
+      continue;
+    }
+
+    RenderRequestReply reply{ partition.GetData(),
+                              partition.GetSize(),
+                              partition.request_id,
+                              partition.has_alpha };
+
+    if (partition.staging)
+      reply.staging_block = partition.staging->index;
+
+    replies.emplace_back(reply);
+
+    partitions.emplace_back(std::move(response.partition));
+  }
+
+  UploadReplies();
+}
+
+void
+ContentView::UploadReplies()
+{
+  std::vector<RenderRequestReply>& replies = m_impl->m_replies;
+
+  if (!replies.empty()) {
+
+    m_impl->m_view_event_streamer.OnRenderRequestReplies(replies.data(),
+                                                         replies.size());
+
+    const auto upload_start = std::chrono::steady_clock::now();
+
+    m_impl->m_view->ReplyRenderRequests(replies.data(), replies.size());
+
+    LogUploadTime(upload_start);
+  }
+
+  replies.clear();
+
+  m_impl->m_partitions.clear();
+}
+
+void
+ContentView::UploadRows(const PartitionBuffer& rows)
+{
+  const auto upload_start = std::chrono::steady_clock::now();
+
+  m_impl->m_view->ReplyRenderRequestRows(
+    rows.request_id, rows.first_row, rows.pixels.data(), rows.pixels.size());
+
+  LogUploadTime(upload_start);
+
+  // The credit of the render request is only returned once all of its rows
+  // have arrived.
+  if ((rows.first_row + rows.GetRowCount()) < rows.height)
+    return;
+
+  const RenderRequestReply reply{
+    nullptr, 0, rows.request_id, rows.has_alpha
+  };
+
+  m_impl->m_view_event_streamer.OnRenderRequestReplies(&reply, 1);
+}
+
+void
+ContentView::LogUploadTime(std::chrono::steady_clock::time_point start)
 {
-  m_impl->m_view->ReplyRenderRequest(buffer, w * h * 3, req_id);
+  const auto upload_time = std::chrono::steady_clock::now() - start;
+
+  m_impl->m_monitor->LogUploadTime(
+    std::chrono::duration_cast<std::chrono::microseconds>(upload_time).count());
 }
 
 void
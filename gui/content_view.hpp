@@ -2,12 +2,18 @@
 
 #include <QWidget>
 
+#include <chrono>
+#include <memory>
+
 class QIODevice;
 class QString;
 
 namespace vision::gui {
 
 class ContentViewImpl;
+class SharedPayloadSource;
+
+struct PartitionBuffer;
 
 class ContentView : public QWidget
 {
@@ -21,10 +27,29 @@ public:
 
   void BeginRendering();
 
-  void SendQuitCommand();
+  /// Asks the renderer to quit. The view is done once the renderer exits or
+  /// closes the connection.
+  virtual void SendQuitCommand();
 
   virtual void ForceQuit() = 0;
 
+  /// Sets how many render requests, or how many bytes of replies, may be
+  /// outstanding at a time. Zero means no limit.
+  void SetRequestWindow(size_t max_requests, size_t max_bytes);
+
+  /// Sets how long input events are held, so that the mouse moves in between
+  /// can be merged, before they are sent to the renderer. The input is sent
+  /// sooner if the renderer replies to a render request.
+  void SetInputFlushInterval(int milliseconds);
+
+  /// Sets whether the view keeps requesting frames and shows their average,
+  /// for renderers whose frames are noisy. See View::SetAccumulationEnabled.
+  void SetAccumulationEnabled(bool enabled);
+
+  /// Sets the size of the tiles that frames are requested in, or zero for
+  /// interleaved partitions. See View::SetTileSize.
+  void SetTileSize(size_t tile_size);
+
 signals:
   void InvalidResponse(const QString& reason);
 
@@ -33,17 +58,54 @@ signals:
 protected:
   void HandleIncomingData(const QByteArray&);
 
+  /// Reads the responses from a pipe or socket on a dedicated thread, instead
+  /// of from the IO device. Takes ownership of the file descriptor.
+  ///
+  /// @return False if this is not supported on this platform, in which case
+  ///         the file descriptor is closed.
+  bool ReadFileDescriptor(int fd);
+
+  /// Reads the responses from the socket of the IO device on a dedicated
+  /// thread, while commands are still written through the IO device. The
+  /// device has to be opened unbuffered, so that it never reads from the
+  /// socket itself. The reader gets a duplicate of the socket descriptor.
+  ///
+  /// @return False if this is not supported on this platform, in which case
+  ///         the IO device has to be read instead.
+  bool ReadSocketDescriptor(qintptr descriptor);
+
+  /// Sends the input events, and the cancel and quit commands, through a
+  /// separate device, so that they do not wait behind render requests. The
+  /// renderer has to read both devices.
+  void SetInputDevice(QIODevice* io_device);
+
+  /// Sets where the payloads of shared frames are found. This has to be
+  /// called before any responses are read.
+  void SetSharedPayloadSource(std::unique_ptr<SharedPayloadSource> source);
+
 protected slots:
   void ReadIODevice();
 
-  void ForwardRGBBuffer(const unsigned char* rgb_buffer,
-                        size_t w,
-                        size_t h,
-                        size_t req_id);
+  /// Uploads the partitions decoded by the response worker.
+  void HandleDecodedResponses();
+
+  /// Called once the file descriptor read on the dedicated thread reaches its
+  /// end. Views whose IO device would otherwise report that are expected to
+  /// close it.
+  virtual void HandleEndOfStream() {}
 
 protected:
   void AddToolTab(const QString& name, QWidget* widget);
 
+private:
+  /// Uploads the batch of complete partitions taken so far.
+  void UploadReplies();
+
+  /// Uploads the rows of a partition that is received incrementally.
+  void UploadRows(const PartitionBuffer& rows);
+
+  void LogUploadTime(std::chrono::steady_clock::time_point start);
+
 private:
   ContentViewImpl* m_impl;
 };
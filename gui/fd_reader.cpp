@@ -0,0 +1,172 @@
+#include "fd_reader.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace vision::gui {
+
+namespace {
+
+void
+CloseIfOpen(int& fd)
+{
+  if (fd >= 0) {
+    ::close(fd);
+    fd = -1;
+  }
+}
+
+bool
+AddToEpoll(int epoll_fd, int fd)
+{
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.fd = fd;
+
+  return ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+} // namespace
+
+FdReader::FdReader(FdReaderObserver& observer, size_t buffer_size)
+  : m_observer(observer)
+  , m_buffer(buffer_size)
+{}
+
+FdReader::~FdReader()
+{
+  Stop();
+}
+
+bool
+FdReader::Start(int fd)
+{
+  Stop();
+
+  m_fd = fd;
+
+  const int flags = ::fcntl(m_fd, F_GETFL);
+
+  if ((flags < 0) || (::fcntl(m_fd, F_SETFL, flags | O_NONBLOCK) < 0)) {
+    CloseIfOpen(m_fd);
+    return false;
+  }
+
+  m_epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+
+  m_stop_fd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+  if ((m_epoll_fd < 0) || (m_stop_fd < 0) || !AddToEpoll(m_epoll_fd, m_fd) ||
+      !AddToEpoll(m_epoll_fd, m_stop_fd)) {
+    CloseIfOpen(m_fd);
+    CloseIfOpen(m_epoll_fd);
+    CloseIfOpen(m_stop_fd);
+    return false;
+  }
+
+  m_thread = std::thread(&FdReader::Run, this);
+
+  return true;
+}
+
+void
+FdReader::Stop()
+{
+  if (m_thread.joinable()) {
+
+    const uint64_t value = 1;
+
+    while ((::write(m_stop_fd, &value, sizeof(value)) < 0) && (errno == EINTR))
+      continue;
+
+    m_thread.join();
+  }
+
+  CloseIfOpen(m_fd);
+  CloseIfOpen(m_epoll_fd);
+  CloseIfOpen(m_stop_fd);
+}
+
+size_t
+FdReader::EnlargePipe(int fd, size_t size)
+{
+  ::fcntl(fd, F_SETPIPE_SZ, int(size));
+
+  const int capacity = ::fcntl(fd, F_GETPIPE_SZ);
+
+  return (capacity > 0) ? size_t(capacity) : 0;
+}
+
+void
+FdReader::Run()
+{
+  for (;;) {
+
+    epoll_event events[2];
+
+    const int count = ::epoll_wait(m_epoll_fd, events, 2, -1);
+
+    if (count < 0) {
+
+      if (errno == EINTR)
+        continue;
+
+      m_observer.OnReadError(errno);
+
+      return;
+    }
+
+    for (int i = 0; i < count; i++) {
+
+      if (events[i].data.fd == m_stop_fd)
+        return;
+    }
+
+    if (!ReadAvailable())
+      return;
+  }
+}
+
+bool
+FdReader::ReadAvailable()
+{
+  for (;;) {
+
+    const ssize_t read_size = ::read(m_fd, m_buffer.data(), m_buffer.size());
+
+    if (read_size > 0) {
+
+      m_observer.OnRead(m_buffer.data(), size_t(read_size));
+
+      // A short read means the pipe is drained, which saves a read that
+      // would only return EAGAIN.
+      if (size_t(read_size) < m_buffer.size())
+        return true;
+
+    } else if (read_size == 0) {
+
+      m_observer.OnEndOfFile();
+
+      return false;
+
+    } else if (errno == EINTR) {
+
+      continue;
+
+    } else if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+
+      return true;
+
+    } else {
+
+      m_observer.OnReadError(errno);
+
+      return false;
+    }
+  }
+}
+
+} // namespace vision::gui
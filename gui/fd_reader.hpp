@@ -0,0 +1,86 @@
+#pragma once
+
+#include <thread>
+#include <vector>
+
+#include <stddef.h>
+
+namespace vision::gui {
+
+class FdReaderObserver
+{
+public:
+  virtual ~FdReaderObserver() = default;
+
+  /// Called on the reader thread with the data of each read. The data is only
+  /// valid for the duration of the call.
+  virtual void OnRead(const char* data, size_t size) = 0;
+
+  /// Called on the reader thread when the other end is closed.
+  virtual void OnEndOfFile() = 0;
+
+  /// Called on the reader thread when a read fails.
+  virtual void OnReadError(int error_number) = 0;
+};
+
+/// Reads a pipe or socket on a dedicated thread, waiting on it with epoll. The
+/// data is read into a buffer that is allocated once and passed straight to
+/// the observer. This is only available on Linux.
+class FdReader final
+{
+public:
+  /// The default size of the read buffer, which is also the size the pipe
+  /// capacity is enlarged to.
+  static constexpr size_t default_buffer_size = 1048576;
+
+  FdReader(FdReaderObserver& observer,
+           size_t buffer_size = default_buffer_size);
+
+  FdReader(const FdReader&) = delete;
+
+  FdReader& operator=(const FdReader&) = delete;
+
+  /// Stops the reader thread and closes the file descriptor.
+  ~FdReader();
+
+  /// Starts reading on a new thread. The reader takes ownership of the file
+  /// descriptor.
+  ///
+  /// @return True on success, false on failure. On failure, the file
+  ///         descriptor is closed.
+  bool Start(int fd);
+
+  /// Stops the reader thread and waits for it to exit. Can be called from any
+  /// thread except the reader thread.
+  void Stop();
+
+  /// Attempts to enlarge the capacity of a pipe, so that the writer can get
+  /// further ahead of the reader and each read returns more data. This is
+  /// limited by /proc/sys/fs/pipe-max-size for unprivileged processes.
+  ///
+  /// @return The capacity of the pipe, or zero if it is not a pipe.
+  static size_t EnlargePipe(int fd, size_t size = default_buffer_size);
+
+private:
+  void Run();
+
+  /// @return False if reading should stop.
+  bool ReadAvailable();
+
+private:
+  FdReaderObserver& m_observer;
+
+  std::vector<char> m_buffer;
+
+  int m_fd = -1;
+
+  int m_epoll_fd = -1;
+
+  /// An event file descriptor used to wake up the reader thread when it
+  /// should stop.
+  int m_stop_fd = -1;
+
+  std::thread m_thread;
+};
+
+} // namespace vision::gui
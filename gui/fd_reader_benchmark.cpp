@@ -0,0 +1,166 @@
+#include <benchmark/benchmark.h>
+
+#include "fd_reader.hpp"
+#include "response.hpp"
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace vision::gui;
+
+namespace {
+
+/// Writes the same data into a pipe a number of times, the way a renderer
+/// would write its replies to standard output.
+void
+WriteAll(int fd, const std::string& data, size_t count)
+{
+  for (size_t i = 0; i < count; i++) {
+
+    size_t offset = 0;
+
+    while (offset < data.size()) {
+
+      const ssize_t write_size =
+        ::write(fd, data.data() + offset, data.size() - offset);
+
+      if (write_size < 0)
+        return;
+
+      offset += size_t(write_size);
+    }
+  }
+}
+
+class NullRowObserver final : public ResponseObserver
+{
+public:
+  void OnInvalidResponse(const std::string_view&) override {}
+
+  void OnBufferOverflow(size_t) override {}
+
+  void OnRGBBuffer(const unsigned char* rgb, size_t, size_t, size_t) override
+  {
+    benchmark::DoNotOptimize(rgb);
+  }
+
+  bool SupportsRows() const override { return true; }
+
+  void OnRGBRows(const RGBRowRange& rows) override
+  {
+    benchmark::DoNotOptimize(rows.data);
+  }
+};
+
+class PipeSink final : public FdReaderObserver
+{
+public:
+  PipeSink(ResponseParser* parser)
+    : m_parser(parser)
+  {}
+
+  void OnRead(const char* data, size_t size) override
+  {
+    if (m_parser)
+      m_parser->Write(data, size);
+    else
+      benchmark::DoNotOptimize(data);
+  }
+
+  void OnEndOfFile() override { Finish(); }
+
+  void OnReadError(int) override { Finish(); }
+
+  void WaitUntilFinished()
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this] { return m_finished; });
+  }
+
+private:
+  void Finish()
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_finished = true;
+    m_condition.notify_one();
+  }
+
+private:
+  ResponseParser* m_parser;
+
+  std::mutex m_mutex;
+
+  std::condition_variable m_condition;
+
+  bool m_finished = false;
+};
+
+/// Measures the throughput of a local pipe read by the reader thread, with or
+/// without the responses being parsed as they are read.
+void
+ReadPipe(benchmark::State& state, bool parse)
+{
+  const size_t w = 1024;
+  const size_t h = 8;
+  const size_t count = 256;
+
+  const std::string header = "rgb buffer " + std::to_string(w) + " " +
+                             std::to_string(h) + " 0\n";
+
+  const std::string reply = header + std::string(w * h * 3, char(0x7f));
+
+  NullRowObserver observer;
+
+  for (auto _ : state) {
+
+    int fds[2];
+
+    if (::pipe2(fds, O_CLOEXEC) != 0) {
+      state.SkipWithError("Failed to create a pipe.");
+      break;
+    }
+
+    FdReader::EnlargePipe(fds[0]);
+
+    auto parser = ResponseParser::Create(observer);
+
+    PipeSink sink(parse ? parser.get() : nullptr);
+
+    FdReader reader(sink);
+
+    reader.Start(fds[0]);
+
+    std::thread writer(WriteAll, fds[1], std::cref(reply), count);
+
+    writer.join();
+
+    ::close(fds[1]);
+
+    sink.WaitUntilFinished();
+  }
+
+  state.SetBytesProcessed(int64_t(state.iterations() * reply.size() * count));
+}
+
+void
+BM_FdReader_Pipe(benchmark::State& state)
+{
+  ReadPipe(state, false);
+}
+
+void
+BM_FdReader_PipeParse(benchmark::State& state)
+{
+  ReadPipe(state, true);
+}
+
+} // namespace
+
+BENCHMARK(BM_FdReader_Pipe)->UseRealTime();
+
+BENCHMARK(BM_FdReader_PipeParse)->UseRealTime();
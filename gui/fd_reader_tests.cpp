@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+
+#include "fd_reader.hpp"
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace vision::gui;
+
+namespace {
+
+class ReadLogger final : public FdReaderObserver
+{
+public:
+  void OnRead(const char* data, size_t size) override
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_data.append(data, size);
+  }
+
+  void OnEndOfFile() override
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_end_of_file = true;
+    m_condition.notify_one();
+  }
+
+  void OnReadError(int) override
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_read_error = true;
+    m_condition.notify_one();
+  }
+
+  std::string WaitForEndOfFile()
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this] { return m_end_of_file || m_read_error; });
+    return m_data;
+  }
+
+  bool HasReadError()
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_read_error;
+  }
+
+private:
+  std::mutex m_mutex;
+
+  std::condition_variable m_condition;
+
+  std::string m_data;
+
+  bool m_end_of_file = false;
+
+  bool m_read_error = false;
+};
+
+} // namespace
+
+TEST(FdReader, ReadUntilEndOfFile)
+{
+  int fds[2];
+
+  ASSERT_EQ(::pipe2(fds, O_CLOEXEC), 0);
+
+  ReadLogger logger;
+
+  // A small buffer, so that each write takes several reads.
+  FdReader reader(logger, 7);
+
+  ASSERT_TRUE(reader.Start(fds[0]));
+
+  std::string expected;
+
+  for (int i = 0; i < 100; i++) {
+
+    const std::string line = "line " + std::to_string(i) + "\n";
+
+    ASSERT_EQ(::write(fds[1], line.data(), line.size()), ssize_t(line.size()));
+
+    expected += line;
+  }
+
+  ::close(fds[1]);
+
+  EXPECT_EQ(logger.WaitForEndOfFile(), expected);
+
+  EXPECT_FALSE(logger.HasReadError());
+}
+
+TEST(FdReader, StopWhileWaiting)
+{
+  int fds[2];
+
+  ASSERT_EQ(::pipe2(fds, O_CLOEXEC), 0);
+
+  ReadLogger logger;
+
+  FdReader reader(logger);
+
+  ASSERT_TRUE(reader.Start(fds[0]));
+
+  reader.Stop();
+
+  ::close(fds[1]);
+
+  EXPECT_FALSE(logger.HasReadError());
+}
+
+TEST(FdReader, EnlargePipe)
+{
+  int fds[2];
+
+  ASSERT_EQ(::pipe2(fds, O_CLOEXEC), 0);
+
+  EXPECT_GE(FdReader::EnlargePipe(fds[0], 131072), size_t(65536));
+
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
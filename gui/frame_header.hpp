@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace vision::gui {
+
+/// The kinds of messages that can be sent with the binary protocol.
+enum class FrameType : uint16_t
+{
+  RGBBuffer = 1,
+  /// An RGB buffer whose pixels were written into shared memory. The payload
+  /// is only the position of the pixels in the shared memory, encoded as an
+  /// unsigned 64-bit integer (see @ref SharedFrameRing).
+  SharedRGBBuffer = 2
+};
+
+/// The pixel formats that a frame payload may be encoded with.
+enum class PixelFormat : uint16_t
+{
+  /// Three bytes per pixel, in the order of red, green and blue.
+  RGB888 = 1
+};
+
+/// The fixed size header that precedes every reply once a renderer has switched
+/// to the binary protocol (version 2). A renderer switches by replying to the
+/// "p 2" command with the line "protocol 2". After that line, every reply is a
+/// header followed by exactly @ref payload_size bytes. All fields are encoded
+/// in little endian byte order, with no padding between them.
+struct FrameHeader final
+{
+  /// The number of bytes the header occupies in the stream.
+  static constexpr size_t encoded_size = 32;
+
+  /// The magic number that starts each header, which reads "VSN2".
+  static constexpr uint32_t magic_number = 0x324e5356;
+
+  uint32_t magic = magic_number;
+
+  FrameType type = FrameType::RGBBuffer;
+
+  PixelFormat pixel_format = PixelFormat::RGB888;
+
+  uint32_t width = 0;
+
+  uint32_t height = 0;
+
+  uint64_t request_id = 0;
+
+  uint64_t payload_size = 0;
+};
+
+/// The size of the payload of a shared RGB buffer frame.
+constexpr size_t shared_payload_location_size = 8;
+
+namespace detail {
+
+template<typename Int>
+constexpr Int
+DecodeLittleEndian(const unsigned char* data) noexcept
+{
+  Int value = 0;
+
+  for (size_t i = 0; i < sizeof(Int); i++)
+    value |= Int(data[i]) << (i * 8);
+
+  return value;
+}
+
+template<typename Int>
+constexpr void
+EncodeLittleEndian(Int value, unsigned char* data) noexcept
+{
+  for (size_t i = 0; i < sizeof(Int); i++)
+    data[i] = (unsigned char)((value >> (i * 8)) & 0xff);
+}
+
+} // namespace detail
+
+/// Decodes a frame header from the given data, which must contain at least
+/// @ref FrameHeader::encoded_size bytes.
+constexpr FrameHeader
+DecodeFrameHeader(const unsigned char* data) noexcept
+{
+  using detail::DecodeLittleEndian;
+
+  FrameHeader header;
+  header.magic = DecodeLittleEndian<uint32_t>(data);
+  header.type = FrameType(DecodeLittleEndian<uint16_t>(data + 4));
+  header.pixel_format = PixelFormat(DecodeLittleEndian<uint16_t>(data + 6));
+  header.width = DecodeLittleEndian<uint32_t>(data + 8);
+  header.height = DecodeLittleEndian<uint32_t>(data + 12);
+  header.request_id = DecodeLittleEndian<uint64_t>(data + 16);
+  header.payload_size = DecodeLittleEndian<uint64_t>(data + 24);
+  return header;
+}
+
+/// Encodes a frame header into the given data, which must have room for at
+/// least @ref FrameHeader::encoded_size bytes.
+constexpr void
+EncodeFrameHeader(const FrameHeader& header, unsigned char* data) noexcept
+{
+  using detail::EncodeLittleEndian;
+
+  EncodeLittleEndian(header.magic, data);
+  EncodeLittleEndian(uint16_t(header.type), data + 4);
+  EncodeLittleEndian(uint16_t(header.pixel_format), data + 6);
+  EncodeLittleEndian(header.width, data + 8);
+  EncodeLittleEndian(header.height, data + 12);
+  EncodeLittleEndian(header.request_id, data + 16);
+  EncodeLittleEndian(header.payload_size, data + 24);
+}
+
+} // namespace vision::gui
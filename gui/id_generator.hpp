@@ -7,6 +7,18 @@ class IDGenerator final
 public:
   constexpr size_t GenerateID() noexcept { return m_next++; }
 
+  /// Generates several consecutive IDs.
+  ///
+  /// @return The first of the IDs.
+  constexpr size_t GenerateIDs(size_t count) noexcept
+  {
+    const size_t first = m_next;
+
+    m_next += count;
+
+    return first;
+  }
+
 private:
   size_t m_next = 0;
 };
@@ -0,0 +1,97 @@
+#include "input_coalescer.hpp"
+
+namespace vision::gui {
+
+void
+InputCoalescer::AddKey(std::string_view key, bool state)
+{
+  Event event;
+  event.kind = Event::Kind::Key;
+  event.name = key;
+  event.state = state;
+
+  m_events.emplace_back(std::move(event));
+}
+
+void
+InputCoalescer::AddMouseButton(std::string_view button,
+                               int x,
+                               int y,
+                               bool state)
+{
+  MoveTo(x, y);
+
+  Event event;
+  event.kind = Event::Kind::MouseButton;
+  event.name = button;
+  event.x = x;
+  event.y = y;
+  event.state = state;
+
+  m_events.emplace_back(std::move(event));
+}
+
+void
+InputCoalescer::AddMouseMove(int x, int y)
+{
+  const auto [dx, dy] = MoveTo(x, y);
+
+  if (!m_events.empty() && (m_events.back().kind == Event::Kind::MouseMove)) {
+
+    Event& last = m_events.back();
+    last.x = x;
+    last.y = y;
+    last.dx += dx;
+    last.dy += dy;
+
+    m_merged_moves++;
+
+    return;
+  }
+
+  Event event;
+  event.kind = Event::Kind::MouseMove;
+  event.x = x;
+  event.y = y;
+  event.dx = dx;
+  event.dy = dy;
+
+  m_events.emplace_back(std::move(event));
+}
+
+void
+InputCoalescer::Flush(InputSink& sink)
+{
+  for (const Event& event : m_events) {
+    switch (event.kind) {
+      case Event::Kind::Key:
+        sink.OnKey(event.name, event.state);
+        break;
+      case Event::Kind::MouseButton:
+        sink.OnMouseButton(event.name, event.x, event.y, event.state);
+        break;
+      case Event::Kind::MouseMove:
+        sink.OnMouseMove(event.x, event.y, event.dx, event.dy);
+        break;
+    }
+  }
+
+  m_events.clear();
+}
+
+std::pair<int, int>
+InputCoalescer::MoveTo(int x, int y)
+{
+  // The first position has nothing to be measured from.
+  const int dx = m_has_position ? (x - m_last_x) : 0;
+  const int dy = m_has_position ? (y - m_last_y) : 0;
+
+  m_has_position = true;
+
+  m_last_x = x;
+  m_last_y = y;
+
+  return { dx, dy };
+}
+
+} // namespace vision::gui
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <stddef.h>
+
+namespace vision::gui {
+
+/// Receives the input events that are let through by an @ref InputCoalescer.
+class InputSink
+{
+public:
+  virtual ~InputSink() = default;
+
+  virtual void OnKey(std::string_view key, bool state) = 0;
+
+  virtual void OnMouseButton(std::string_view button,
+                             int x,
+                             int y,
+                             bool state) = 0;
+
+  /// @param dx The horizontal distance that the mouse moved since the last
+  ///           mouse event, which may span several merged moves.
+  ///
+  /// @param dy The vertical distance that the mouse moved since the last
+  ///           mouse event.
+  virtual void OnMouseMove(int x, int y, int dx, int dy) = 0;
+};
+
+/// Holds input events until they are flushed, merging consecutive mouse moves
+/// into one. This bounds how many events a fast mouse can queue up ahead of
+/// the commands that the renderer needs for the next frame. Key and button
+/// transitions are never dropped, and all events keep their order.
+class InputCoalescer final
+{
+public:
+  void AddKey(std::string_view key, bool state);
+
+  void AddMouseButton(std::string_view button, int x, int y, bool state);
+
+  void AddMouseMove(int x, int y);
+
+  bool HasPendingInput() const noexcept { return !m_events.empty(); }
+
+  /// The number of mouse moves that were merged into an earlier one, since
+  /// the coalescer was made.
+  size_t GetMergedMoveCount() const noexcept { return m_merged_moves; }
+
+  /// Passes the pending events to the sink, in the order they were added.
+  void Flush(InputSink& sink);
+
+private:
+  /// Updates the last known position of the mouse.
+  ///
+  /// @return The distance from the last known position.
+  std::pair<int, int> MoveTo(int x, int y);
+
+private:
+  struct Event final
+  {
+    enum class Kind
+    {
+      Key,
+      MouseButton,
+      MouseMove
+    };
+
+    Kind kind = Kind::Key;
+
+    /// The key or button, if this is a transition.
+    std::string name;
+
+    int x = 0;
+
+    int y = 0;
+
+    int dx = 0;
+
+    int dy = 0;
+
+    bool state = false;
+  };
+
+  /// The events that have not been flushed yet. The capacity is kept between
+  /// flushes.
+  std::vector<Event> m_events;
+
+  size_t m_merged_moves = 0;
+
+  bool m_has_position = false;
+
+  int m_last_x = 0;
+
+  int m_last_y = 0;
+};
+
+} // namespace vision::gui
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+
+#include "input_coalescer.hpp"
+
+#include <sstream>
+#include <string>
+
+using namespace vision::gui;
+
+namespace {
+
+class InputLogger final : public InputSink
+{
+public:
+  void OnKey(std::string_view key, bool state) override
+  {
+    m_log << "k " << key << ' ' << int(state) << '\n';
+  }
+
+  void OnMouseButton(std::string_view button,
+                     int x,
+                     int y,
+                     bool state) override
+  {
+    m_log << "b " << button << ' ' << x << ' ' << y << ' ' << int(state)
+          << '\n';
+  }
+
+  void OnMouseMove(int x, int y, int dx, int dy) override
+  {
+    m_log << "m " << x << ' ' << y << ' ' << dx << ' ' << dy << '\n';
+  }
+
+  std::string TakeLog()
+  {
+    std::string log = m_log.str();
+    m_log.str("");
+    return log;
+  }
+
+private:
+  std::ostringstream m_log;
+};
+
+} // namespace
+
+TEST(InputCoalescer, MergesConsecutiveMoves)
+{
+  InputCoalescer coalescer;
+
+  coalescer.AddMouseMove(10, 10);
+  coalescer.AddMouseMove(12, 9);
+  coalescer.AddMouseMove(15, 7);
+
+  EXPECT_EQ(coalescer.GetMergedMoveCount(), 2);
+
+  InputLogger logger;
+
+  coalescer.Flush(logger);
+
+  EXPECT_EQ(logger.TakeLog(), "m 15 7 5 -3\n");
+
+  EXPECT_FALSE(coalescer.HasPendingInput());
+}
+
+TEST(InputCoalescer, KeepsOrderOfTransitions)
+{
+  InputCoalescer coalescer;
+
+  coalescer.AddMouseMove(1, 1);
+  coalescer.AddMouseMove(2, 2);
+  coalescer.AddMouseButton("left", 3, 3, true);
+  coalescer.AddMouseMove(4, 4);
+  coalescer.AddKey("a", true);
+  coalescer.AddKey("a", false);
+  coalescer.AddMouseMove(6, 6);
+  coalescer.AddMouseMove(7, 6);
+
+  InputLogger logger;
+
+  coalescer.Flush(logger);
+
+  EXPECT_EQ(logger.TakeLog(),
+            "m 2 2 1 1\n"
+            "b left 3 3 1\n"
+            "m 4 4 1 1\n"
+            "k a 1\n"
+            "k a 0\n"
+            "m 7 6 3 2\n");
+}
+
+TEST(InputCoalescer, DeltaSpansFlushes)
+{
+  InputCoalescer coalescer;
+
+  InputLogger logger;
+
+  coalescer.AddMouseMove(5, 5);
+
+  coalescer.Flush(logger);
+
+  coalescer.AddMouseMove(8, 3);
+
+  coalescer.Flush(logger);
+
+  EXPECT_EQ(logger.TakeLog(), "m 5 5 0 0\nm 8 3 3 -2\n");
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <list>
+#include <optional>
+#include <utility>
+
+#include <stddef.h>
+
+namespace vision::gui {
+
+/// A small cache that evicts the least recently used entry once it is full.
+/// The entries are searched linearly, so it is meant for a handful of entries
+/// with keys that are cheap to compare.
+template<typename Key, typename Value>
+class LruCache final
+{
+public:
+  /// @param capacity The maximum number of entries in the cache. The cache
+  ///                 always has room for at least one entry.
+  LruCache(size_t capacity)
+    : m_capacity((capacity > 0) ? capacity : 1)
+  {}
+
+  LruCache(const LruCache&) = delete;
+
+  LruCache& operator=(const LruCache&) = delete;
+
+  size_t GetCapacity() const noexcept { return m_capacity; }
+
+  size_t GetSize() const noexcept { return m_size; }
+
+  /// Finds an entry, which becomes the most recently used one.
+  ///
+  /// @return The value of the entry, or null if there is no entry for the key.
+  Value* Find(const Key& key)
+  {
+    auto it = FindEntry(key);
+    if (it == m_entries.end())
+      return nullptr;
+
+    m_entries.splice(m_entries.begin(), m_entries, it);
+
+    return &m_entries.front().second;
+  }
+
+  /// Adds an entry as the most recently used one. An existing entry with the
+  /// same key is replaced. If the cache is full, the least recently used
+  /// entry is evicted.
+  ///
+  /// @return The value of the new entry.
+  Value& Insert(const Key& key, Value value)
+  {
+    auto it = FindEntry(key);
+
+    if (it != m_entries.end()) {
+      it->second = std::move(value);
+      m_entries.splice(m_entries.begin(), m_entries, it);
+      return m_entries.front().second;
+    }
+
+    if (m_size >= m_capacity) {
+      m_entries.pop_back();
+      m_size--;
+    }
+
+    m_entries.emplace_front(key, std::move(value));
+
+    m_size++;
+
+    return m_entries.front().second;
+  }
+
+  /// Removes an entry from the cache.
+  ///
+  /// @return The value of the entry, if there was one for the key.
+  std::optional<Value> Take(const Key& key)
+  {
+    auto it = FindEntry(key);
+    if (it == m_entries.end())
+      return std::nullopt;
+
+    std::optional<Value> value(std::move(it->second));
+
+    m_entries.erase(it);
+
+    m_size--;
+
+    return value;
+  }
+
+  void Clear()
+  {
+    m_entries.clear();
+
+    m_size = 0;
+  }
+
+private:
+  using Entry = std::pair<Key, Value>;
+
+  auto FindEntry(const Key& key) -> typename std::list<Entry>::iterator
+  {
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+      if (it->first == key)
+        return it;
+    }
+
+    return m_entries.end();
+  }
+
+private:
+  /// The entries, from the most recently used to the least recently used.
+  std::list<Entry> m_entries;
+
+  size_t m_size = 0;
+
+  size_t m_capacity = 0;
+};
+
+} // namespace vision::gui
@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include "lru_cache.hpp"
+
+#include <memory>
+
+using namespace vision::gui;
+
+TEST(LruCache, Find)
+{
+  LruCache<int, int> cache(2);
+
+  EXPECT_EQ(cache.Find(1), nullptr);
+
+  cache.Insert(1, 10);
+
+  ASSERT_NE(cache.Find(1), nullptr);
+  EXPECT_EQ(*cache.Find(1), 10);
+
+  EXPECT_EQ(cache.GetSize(), 1);
+}
+
+TEST(LruCache, EvictsLeastRecentlyUsed)
+{
+  LruCache<int, int> cache(2);
+
+  cache.Insert(1, 10);
+  cache.Insert(2, 20);
+
+  // Makes the first entry the most recently used one.
+  EXPECT_NE(cache.Find(1), nullptr);
+
+  cache.Insert(3, 30);
+
+  EXPECT_EQ(cache.GetSize(), 2);
+  EXPECT_NE(cache.Find(1), nullptr);
+  EXPECT_EQ(cache.Find(2), nullptr);
+  EXPECT_NE(cache.Find(3), nullptr);
+}
+
+TEST(LruCache, InsertReplaces)
+{
+  LruCache<int, int> cache(2);
+
+  cache.Insert(1, 10);
+  cache.Insert(1, 11);
+
+  EXPECT_EQ(cache.GetSize(), 1);
+  EXPECT_EQ(*cache.Find(1), 11);
+}
+
+TEST(LruCache, Take)
+{
+  LruCache<int, std::unique_ptr<int>> cache(2);
+
+  cache.Insert(1, std::make_unique<int>(10));
+
+  std::optional<std::unique_ptr<int>> value = cache.Take(1);
+
+  ASSERT_TRUE(value);
+  EXPECT_EQ(**value, 10);
+
+  EXPECT_EQ(cache.GetSize(), 0);
+  EXPECT_FALSE(cache.Take(1));
+}
@@ -43,6 +43,20 @@ public:
 
     m_io_chart->legend()->hide();
 
+    addTab(&m_upload_chart_view, "Uploads");
+
+    m_upload_chart_view.setRenderHint(QPainter::Antialiasing);
+
+    m_upload_chart_view.setChart(m_upload_chart);
+
+    m_upload_chart->addSeries(m_upload_series);
+
+    m_upload_chart->createDefaultAxes();
+
+    m_upload_chart->legend()->hide();
+
+    m_upload_chart->axes()[1]->setTitleText("Upload Time (ms)");
+
     m_log.setReadOnly(true);
 
     m_sampling_timer.setInterval(m_sampling_interval);
@@ -60,6 +74,10 @@ public:
     delete m_read_series;
 
     delete m_io_chart;
+
+    delete m_upload_series;
+
+    delete m_upload_chart;
   }
 
   void LogError(const QString& msg) override
@@ -91,6 +109,11 @@ public:
     m_read_count += byte_count;
   }
 
+  void LogUploadTime(size_t microseconds) override
+  {
+    m_upload_time += microseconds;
+  }
+
 private:
   void HandleSamplingPeriod()
   {
@@ -101,6 +124,39 @@ private:
     AddReadSpeedSample(read_speed);
 
     m_read_count = 0;
+
+    AddUploadTimeSample(m_upload_time * 1.0e-3f);
+
+    m_upload_time = 0;
+  }
+
+  /// Adds the time spent uploading during a sampling period, in milliseconds.
+  void AddUploadTimeSample(float upload_time)
+  {
+    TimePoint t = Clock::now();
+
+    size_t delta_t =
+      std::chrono::duration_cast<Microseconds>(t - m_start_time).count();
+
+    if (m_upload_samples.size() >= m_max_read_samples)
+      m_upload_samples.erase(m_upload_samples.begin());
+
+    m_upload_samples.emplace_back(QPointF(delta_t * 1e-6, upload_time));
+
+    float max_upload_time = 0;
+
+    for (const auto& sample : m_upload_samples)
+      max_upload_time = std::max(max_upload_time, float(sample.y()));
+
+    m_upload_series->replace(m_upload_samples);
+
+    QList<QtCharts::QAbstractAxis*> axes = m_upload_chart->axes();
+
+    axes[0]->setMin(m_upload_samples.front().x());
+    axes[0]->setMax(m_upload_samples.back().x());
+
+    axes[1]->setMin(0);
+    axes[1]->setMax(max_upload_time);
   }
 
   void AddReadSpeedSample(float read_speed)
@@ -185,6 +241,12 @@ private:
 
   size_t m_read_count = 0;
 
+  /// The time spent uploading in the current sampling period, in
+  /// microseconds.
+  size_t m_upload_time = 0;
+
+  QVector<QPointF> m_upload_samples;
+
   size_t m_max_read_samples = 128;
 
   std::vector<IOSample> m_samples;
@@ -198,6 +260,12 @@ private:
   QtCharts::QSplineSeries* m_read_series = new QtCharts::QSplineSeries();
 
   QtCharts::QChartView m_io_chart_view{ this };
+
+  QtCharts::QChart* m_upload_chart = new QtCharts::QChart();
+
+  QtCharts::QSplineSeries* m_upload_series = new QtCharts::QSplineSeries();
+
+  QtCharts::QChartView m_upload_chart_view{ this };
 };
 
 } // namespace
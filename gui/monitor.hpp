@@ -24,6 +24,9 @@ public:
   virtual void LogConnectionWrite(size_t byte_count) = 0;
 
   virtual void LogConnectionRead(size_t byte_count) = 0;
+
+  /// Logs the time that the GUI thread spent uploading replies to the GPU.
+  virtual void LogUploadTime(size_t microseconds) = 0;
 };
 
 Monitor*
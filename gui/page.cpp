@@ -3,11 +3,15 @@
 #include "address_bar.hpp"
 #include "content_view.hpp"
 #include "process_view.hpp"
+#include "tcp_view.hpp"
+#include "unix_socket_view.hpp"
 #include "view.hpp"
 
 #include <QLabel>
+#include <QLocalSocket>
 #include <QProcess>
 #include <QStackedWidget>
+#include <QTcpSocket>
 #include <QTimer>
 #include <QVBoxLayout>
 #include <QWidget>
@@ -124,10 +128,12 @@ protected slots:
   {
     if (m_content_view) {
 
-      Disconnect();
-
+      // Queued first, since the view may already be gone once the
+      // disconnect returns.
       m_connection_queue.emplace_back(address);
 
+      Disconnect();
+
     } else {
 
       Connect(address);
@@ -143,6 +149,10 @@ protected slots:
         StartProgram(address.data);
         break;
       case AddressKind::Tcp:
+        StartConnection(address.data);
+        break;
+      case AddressKind::Unix:
+        AttachToRenderer(address.data);
         break;
       case AddressKind::Unknown:
         break;
@@ -165,21 +175,100 @@ private:
             this,
             &PageImpl::OnProcessExit);
 
-    connect(process_view,
+    SetContentView(process_view);
+
+    process->start();
+  }
+
+  void StartConnection(const QString& address)
+  {
+    TcpView* tcp_view = new TcpView(&m_content_area, address);
+
+    QTcpSocket* socket = tcp_view->GetSocket();
+
+    connect(socket, &QTcpSocket::connected, this, &PageImpl::OnConnected);
+
+    connect(
+      socket, &QTcpSocket::disconnected, this, &PageImpl::OnConnectionClosed);
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+    connect(socket,
+            &QTcpSocket::errorOccurred,
+            this,
+            [this, socket](QAbstractSocket::SocketError error) {
+              OnSocketError(error, socket->errorString());
+            });
+#else
+    connect(socket,
+            QOverload<QAbstractSocket::SocketError>::of(&QTcpSocket::error),
+            this,
+            [this, socket](QAbstractSocket::SocketError error) {
+              OnSocketError(error, socket->errorString());
+            });
+#endif
+
+    SetContentView(tcp_view);
+
+    if (!tcp_view->ConnectToRenderer()) {
+
+      EmitError("The address should be of the form host:port.");
+
+      m_content_area.RemoveContentView();
+
+      m_content_view = nullptr;
+    }
+  }
+
+  void AttachToRenderer(const QString& path)
+  {
+    UnixSocketView* unix_socket_view =
+      new UnixSocketView(&m_content_area, path);
+
+    QLocalSocket* socket = unix_socket_view->GetSocket();
+
+    connect(socket, &QLocalSocket::connected, this, &PageImpl::OnConnected);
+
+    connect(socket,
+            &QLocalSocket::disconnected,
+            this,
+            &PageImpl::OnConnectionClosed);
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+    connect(socket,
+            &QLocalSocket::errorOccurred,
+            this,
+            [this, socket](QLocalSocket::LocalSocketError error) {
+              OnLocalSocketError(error, socket->errorString());
+            });
+#else
+    connect(socket,
+            QOverload<QLocalSocket::LocalSocketError>::of(&QLocalSocket::error),
+            this,
+            [this, socket](QLocalSocket::LocalSocketError error) {
+              OnLocalSocketError(error, socket->errorString());
+            });
+#endif
+
+    SetContentView(unix_socket_view);
+
+    unix_socket_view->ConnectToRenderer();
+  }
+
+  void SetContentView(ContentView* content_view)
+  {
+    connect(content_view,
             &ContentView::BufferOverflow,
             this,
             &PageImpl::OnBufferOverflow);
 
-    connect(process_view,
+    connect(content_view,
             &ContentView::InvalidResponse,
             this,
             &PageImpl::OnInvalidResponse);
 
-    m_content_view = process_view;
-
-    m_content_area.SetContentView(process_view);
+    m_content_view = content_view;
 
-    process->start();
+    m_content_area.SetContentView(content_view);
   }
 
   void OnProcessError(QProcess::ProcessError error)
@@ -218,6 +307,9 @@ private:
 
   void OnProcessExit(int, QProcess::ExitStatus)
   {
+    if (!m_content_view)
+      return;
+
     m_content_area.RemoveContentView();
 
     m_content_view = nullptr;
@@ -225,6 +317,49 @@ private:
     CheckConnectionQueue();
   }
 
+  void OnConnected()
+  {
+    if (m_content_view) {
+
+      m_content_view->BeginRendering();
+    }
+  }
+
+  void OnConnectionClosed()
+  {
+    if (!m_content_view)
+      return;
+
+    m_content_area.RemoveContentView();
+
+    m_content_view = nullptr;
+
+    CheckConnectionQueue();
+  }
+
+  void OnLocalSocketError(QLocalSocket::LocalSocketError error,
+                          const QString& msg)
+  {
+    if (error == QLocalSocket::PeerClosedError)
+      return;
+
+    EmitError(msg);
+
+    Disconnect();
+  }
+
+  void OnSocketError(QAbstractSocket::SocketError error, const QString& msg)
+  {
+    // This is also reported when the renderer exits normally, which is
+    // handled once the socket is disconnected.
+    if (error == QAbstractSocket::RemoteHostClosedError)
+      return;
+
+    EmitError(msg);
+
+    Disconnect();
+  }
+
   void OnBufferOverflow(size_t buffer_max)
   {
     EmitError(QString("Buffer size exceeded %1").arg(buffer_max));
@@ -261,28 +396,45 @@ private:
 
       m_content_view->SendQuitCommand();
 
-      QTimer::singleShot(1000, this, &PageImpl::DisconnectExpiration);
+      // The view is the context, so that this is cancelled if the view exits
+      // on its own before the timer expires.
+      QTimer::singleShot(
+        1000, m_content_view, [this] { DisconnectExpiration(); });
     }
   }
 
   /// Called when either the process or connection is taking too long to exit.
   void DisconnectExpiration()
   {
-    if (m_content_view) {
+    ContentView* content_view = m_content_view;
 
-      m_content_view->ForceQuit();
+    // Cleared first, so that the view exiting while it is forced to quit is
+    // not also handled as a regular exit.
+    m_content_view = nullptr;
 
-      m_content_area.RemoveContentView();
+    if (content_view) {
 
-      m_content_view = nullptr;
+      content_view->ForceQuit();
+
+      m_content_area.RemoveContentView();
     }
 
     CheckConnectionQueue();
   }
 
+  /// Connects to the most recently requested address, if a connection was
+  /// requested while the previous one was being closed. This is how the
+  /// refresh button reconnects.
   void CheckConnectionQueue()
   {
-    // TODO
+    if (m_content_view || m_connection_queue.empty())
+      return;
+
+    const Address address = m_connection_queue.back();
+
+    m_connection_queue.clear();
+
+    Connect(address);
   }
 
 private:
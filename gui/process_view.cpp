@@ -1,44 +1,141 @@
 #include "process_view.hpp"
 
+#include <QLocalSocket>
 #include <QProcess>
+#include <QProcessEnvironment>
 #include <QTextEdit>
 
+#ifdef __linux__
+#include "fd_reader.hpp"
+#include "shared_frame_ring.hpp"
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <vector>
+
 namespace vision::gui {
 
+/// A process that inherits some of the file descriptors of this one. They are
+/// only made inheritable in the child, between the fork and the exec, so that
+/// other processes started in the meantime do not get them.
+class RendererProcess final : public QProcess
+{
+public:
+  using QProcess::QProcess;
+
+  /// Passes a file descriptor to the process when it starts. The descriptor
+  /// is expected to be close-on-exec.
+  void Inherit(int fd) { m_inherited_fds.emplace_back(fd); }
+
+protected:
+  void setupChildProcess() override
+  {
+#ifdef __linux__
+    for (int fd : m_inherited_fds)
+      ::fcntl(fd, F_SETFD, 0);
+#endif
+  }
+
+private:
+  std::vector<int> m_inherited_fds;
+};
+
 class ProcessViewImpl final
 {
   friend ProcessView;
 
-  ProcessViewImpl(QWidget* parent, QProcess* process)
+  ProcessViewImpl(QWidget* parent, RendererProcess* process)
     : m_process(process)
     , m_stderr_log(new QTextEdit(parent))
   {}
 
-  QProcess* m_process;
+  ~ProcessViewImpl()
+  {
+    CloseStandardOutputWriter();
+
+    CloseChildInputChannel();
+  }
+
+  void OnProcessStarted()
+  {
+    CloseStandardOutputWriter();
+
+    CloseChildInputChannel();
+  }
+
+  void CloseStandardOutputWriter()
+  {
+#ifdef __linux__
+    if (m_stdout_writer >= 0) {
+      ::close(m_stdout_writer);
+      m_stdout_writer = -1;
+    }
+#endif
+  }
+
+  void CloseChildInputChannel()
+  {
+#ifdef __linux__
+    if (m_child_input_channel >= 0) {
+      ::close(m_child_input_channel);
+      m_child_input_channel = -1;
+    }
+#endif
+  }
+
+  RendererProcess* m_process;
 
   QTextEdit* m_stderr_log;
+
+  /// The write end of the standard output pipe, which is only kept open until
+  /// the process is started so that the child inherits it.
+  int m_stdout_writer = -1;
+
+  /// The end of the input channel that belongs to the child, which is only
+  /// kept open until the process is started so that the child inherits it.
+  int m_child_input_channel = -1;
+
+  /// The end of the input channel that belongs to this process.
+  QLocalSocket* m_input_channel = nullptr;
 };
 
 ProcessView::ProcessView(QWidget* parent, const QString& program_path)
-  : ProcessView(parent, new QProcess(parent))
+  : ProcessView(parent, new RendererProcess(parent))
 {
   m_impl->m_process->setProgram(program_path);
 }
 
-ProcessView::ProcessView(QWidget* parent, QProcess* process)
+ProcessView::ProcessView(QWidget* parent, RendererProcess* process)
   : ContentView(parent, process)
   , m_impl(new ProcessViewImpl(this, process))
 {
-  connect(process,
-          &QProcess::readyReadStandardOutput,
-          this,
-          &ProcessView::ReadStandardOutput);
+  // The parser has to have its payload source before the reader thread is
+  // started, since the source is not synchronized with it.
+  ShareFrameRing();
+
+  if (!ReadStandardOutputPipe()) {
+    connect(process,
+            &QProcess::readyReadStandardOutput,
+            this,
+            &ProcessView::ReadStandardOutput);
+  }
 
   connect(process,
           &QProcess::readyReadStandardError,
           this,
           &ProcessView::ReadStandardError);
 
+  ShareInputChannel();
+
+  auto on_started = [this] { m_impl->OnProcessStarted(); };
+
+  connect(process, &QProcess::started, this, on_started);
+
+  connect(process, &QProcess::errorOccurred, this, on_started);
+
   AddToolTab("Error Log", m_impl->m_stderr_log);
 
   m_impl->m_stderr_log->setReadOnly(true);
@@ -64,6 +161,118 @@ ProcessView::ForceQuit()
     m_impl->m_process->waitForFinished(1000);
 }
 
+bool
+ProcessView::ReadStandardOutputPipe()
+{
+#ifdef __linux__
+  int fds[2];
+
+  if (::pipe2(fds, O_CLOEXEC) != 0)
+    return false;
+
+  FdReader::EnlargePipe(fds[0]);
+
+  if (!ReadFileDescriptor(fds[0])) {
+    ::close(fds[1]);
+    return false;
+  }
+
+  m_impl->m_stdout_writer = fds[1];
+
+  // QProcess opens the output file before forking, and the path refers to the
+  // pipe itself, so the child writes straight into it.
+  m_impl->m_process->setStandardOutputFile(
+    QString("/proc/self/fd/%1").arg(fds[1]));
+
+  // Once the child has it, the write end is closed here (see
+  // ProcessViewImpl::OnProcessStarted), so that the reader sees the end of
+  // the stream when the child exits.
+
+  return true;
+#else
+  return false;
+#endif
+}
+
+void
+ProcessView::ShareFrameRing()
+{
+#ifdef __linux__
+  std::unique_ptr<SharedFrameRing> ring = SharedFrameRing::Create();
+
+  if (!ring)
+    return;
+
+  m_impl->m_process->Inherit(ring->GetFd());
+
+  QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+
+  environment.insert("VISION_FRAME_RING_FD", QString::number(ring->GetFd()));
+
+  m_impl->m_process->setProcessEnvironment(environment);
+
+  SetSharedPayloadSource(std::move(ring));
+#endif
+}
+
+void
+ProcessView::ShareInputChannel()
+{
+#ifdef __linux__
+  int fds[2];
+
+  if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0)
+    return;
+
+  QLocalSocket* channel = new QLocalSocket(this);
+
+  if (!channel->setSocketDescriptor(fds[0])) {
+    delete channel;
+    ::close(fds[0]);
+    ::close(fds[1]);
+    return;
+  }
+
+  m_impl->m_input_channel = channel;
+
+  m_impl->m_child_input_channel = fds[1];
+
+  m_impl->m_process->Inherit(fds[1]);
+
+  QProcessEnvironment environment = m_impl->m_process->processEnvironment();
+
+  if (environment.isEmpty())
+    environment = QProcessEnvironment::systemEnvironment();
+
+  environment.insert("VISION_INPUT_FD", QString::number(fds[1]));
+
+  m_impl->m_process->setProcessEnvironment(environment);
+
+  connect(channel,
+          &QLocalSocket::readyRead,
+          this,
+          &ProcessView::ReadInputChannel);
+#endif
+}
+
+void
+ProcessView::ReadInputChannel()
+{
+  QLocalSocket* channel = m_impl->m_input_channel;
+
+  if (!channel->canReadLine())
+    return;
+
+  // The renderer only says hello once, and nothing else is expected from it.
+  disconnect(channel,
+             &QLocalSocket::readyRead,
+             this,
+             &ProcessView::ReadInputChannel);
+
+  if (channel->readLine().trimmed() == "input")
+    SetInputDevice(channel);
+}
+
 void
 ProcessView::ReadStandardOutput()
 {
@@ -8,7 +8,12 @@ class QByteArray;
 namespace vision::gui {
 
 class ProcessViewImpl;
+class RendererProcess;
 
+/// Runs a renderer as a child process. The output pipe, the shared frame
+/// ring and the input channel are handed to the child when it starts, and the
+/// ends that belong to the child are closed once it has them, so the process
+/// can only be started once. A new view is made for each run of a renderer.
 class ProcessView : public ContentView
 {
   Q_OBJECT
@@ -28,8 +33,29 @@ protected slots:
 
   void ReadStandardError();
 
+  /// Waits for the renderer to say that it reads the input channel.
+  void ReadInputChannel();
+
 private:
-  ProcessView(QWidget* parent, QProcess* process);
+  ProcessView(QWidget* parent, RendererProcess* process);
+
+  /// Redirects the standard output of the process into a pipe that is read on
+  /// a dedicated thread, bypassing the event loop. Expects the shared frame
+  /// ring to be set up already, since the thread starts reading right away.
+  ///
+  /// @return False if this is not supported, in which case the output is read
+  ///         through the process.
+  bool ReadStandardOutputPipe();
+
+  /// Creates a shared memory ring that the process may write pixels into and
+  /// passes it to the process when it starts.
+  void ShareFrameRing();
+
+  /// Creates a socket for input events and control commands and passes it to
+  /// the process when it starts. The socket is only used for them once the
+  /// renderer writes an "input" line to it, so renderers that do not read it
+  /// still get them on standard input.
+  void ShareInputChannel();
 
 private:
   ProcessViewImpl* m_impl;
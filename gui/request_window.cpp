@@ -0,0 +1,146 @@
+#include "request_window.hpp"
+
+#include "schedule.hpp"
+
+#include <algorithm>
+
+namespace vision::gui {
+
+RequestWindow::RequestWindow(size_t max_requests, size_t max_bytes)
+  : m_max_requests(max_requests)
+  , m_max_bytes(max_bytes)
+{}
+
+void
+RequestWindow::SetLimits(size_t max_requests, size_t max_bytes) noexcept
+{
+  m_max_requests = max_requests;
+
+  m_max_bytes = max_bytes;
+}
+
+void
+RequestWindow::Queue(const Schedule& schedule)
+{
+  m_queue.clear();
+
+  m_next = 0;
+
+  const size_t req_count = schedule.GetRenderRequestCount();
+
+  for (size_t i = 0; i < req_count; i++) {
+    if (!schedule.IsRenderRequestComplete(i))
+      m_queue.emplace_back(schedule.GetRenderRequest(i));
+  }
+}
+
+bool
+RequestWindow::TakeNext(RenderRequest& req)
+{
+  if (m_next >= m_queue.size())
+    return false;
+
+  const size_t payload_size = GetPayloadSize(m_queue[m_next]);
+
+  if (!m_outstanding.empty()) {
+
+    if (m_max_requests && (m_outstanding.size() >= m_max_requests))
+      return false;
+
+    if (m_max_bytes && ((m_outstanding_bytes + payload_size) > m_max_bytes))
+      return false;
+  }
+
+  req = m_queue[m_next++];
+
+  m_outstanding.emplace_back(OutstandingRequest{ req.id, payload_size });
+
+  m_outstanding_bytes += payload_size;
+
+  return true;
+}
+
+bool
+RequestWindow::Complete(size_t request_id) noexcept
+{
+  auto it = std::find_if(
+    m_outstanding.begin(),
+    m_outstanding.end(),
+    [request_id](const OutstandingRequest& r) { return r.id == request_id; });
+
+  if (it == m_outstanding.end())
+    return false;
+
+  m_outstanding_bytes -= it->payload_size;
+
+  m_outstanding.erase(it);
+
+  return true;
+}
+
+void
+RequestWindow::CancelBefore(size_t request_id) noexcept
+{
+  // The cancelled requests are moved to the end, keeping their payload sizes,
+  // so that their credit can be returned before they are erased.
+  auto first_cancelled = std::stable_partition(
+    m_outstanding.begin(),
+    m_outstanding.end(),
+    [request_id](const OutstandingRequest& r) { return r.id >= request_id; });
+
+  for (auto it = first_cancelled; it != m_outstanding.end(); it++)
+    m_outstanding_bytes -= it->payload_size;
+
+  m_outstanding.erase(first_cancelled, m_outstanding.end());
+}
+
+void
+RequestWindow::Reissue()
+{
+  std::vector<RenderRequest> queue;
+
+  // Outstanding requests of earlier frames are no longer queued, so only
+  // those of the current frame are issued again.
+  for (size_t i = 0; i < m_next; i++) {
+
+    const size_t id = m_queue[i].id;
+
+    auto it = std::find_if(
+      m_outstanding.begin(),
+      m_outstanding.end(),
+      [id](const OutstandingRequest& r) { return r.id == id; });
+
+    if (it != m_outstanding.end())
+      queue.emplace_back(m_queue[i]);
+  }
+
+  queue.insert(queue.end(), m_queue.begin() + m_next, m_queue.end());
+
+  m_queue = std::move(queue);
+
+  m_next = 0;
+
+  m_outstanding.clear();
+
+  m_outstanding_bytes = 0;
+}
+
+void
+RequestWindow::Clear() noexcept
+{
+  m_queue.clear();
+
+  m_next = 0;
+
+  m_outstanding.clear();
+
+  m_outstanding_bytes = 0;
+}
+
+size_t
+RequestWindow::GetPayloadSize(const RenderRequest& req) noexcept
+{
+  return req.x_pixel_count * req.y_pixel_count * 3;
+}
+
+} // namespace vision::gui
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "render_request.hpp"
+
+#include <vector>
+
+#include <stddef.h>
+
+namespace vision::gui {
+
+class Schedule;
+
+/// Limits how much rendering is outstanding at a time, so that the input of a
+/// renderer does not fill up with requests for frames that are obsolete by the
+/// time they would be rendered. The requests of a frame are queued and issued
+/// as replies return their credit. Queuing the requests of a new frame drops
+/// the requests of the previous frame that were not issued yet.
+class RequestWindow final
+{
+public:
+  static constexpr size_t default_max_requests = 16;
+
+  /// @param max_requests The number of requests that may be outstanding, or
+  ///                     zero for no limit.
+  ///
+  /// @param max_bytes The number of payload bytes that may be outstanding, or
+  ///                  zero for no limit. A single request is always allowed,
+  ///                  even if its payload exceeds this budget.
+  RequestWindow(size_t max_requests = default_max_requests,
+                size_t max_bytes = 0);
+
+  void SetLimits(size_t max_requests, size_t max_bytes) noexcept;
+
+  /// Replaces the queued requests with the requests of a new frame. Requests
+  /// that the schedule already has the pixels of are not queued.
+  void Queue(const Schedule& schedule);
+
+  /// Takes the next queued request, if the window has room for it.
+  ///
+  /// @return False if there is no queued request or no room for it.
+  bool TakeNext(RenderRequest& req);
+
+  /// Returns the credit of an outstanding request, once its reply arrived.
+  ///
+  /// @return False if the request is not outstanding.
+  bool Complete(size_t request_id) noexcept;
+
+  /// Drops the outstanding requests with an ID below the given one, which the
+  /// renderer was asked to cancel.
+  void CancelBefore(size_t request_id) noexcept;
+
+  /// Queues the outstanding requests again, ahead of the other queued
+  /// requests, and returns their credit. This is for when their replies may
+  /// have been lost, such as along with invalid input, since their credit
+  /// would otherwise only come back once the next frame is queued.
+  void Reissue();
+
+  /// Drops all queued and outstanding requests.
+  void Clear() noexcept;
+
+  size_t GetQueuedCount() const noexcept { return m_queue.size() - m_next; }
+
+  size_t GetOutstandingCount() const noexcept { return m_outstanding.size(); }
+
+  size_t GetOutstandingBytes() const noexcept { return m_outstanding_bytes; }
+
+  /// @return The number of payload bytes the reply to a request will have.
+  static size_t GetPayloadSize(const RenderRequest& req) noexcept;
+
+private:
+  struct OutstandingRequest final
+  {
+    size_t id = 0;
+
+    size_t payload_size = 0;
+  };
+
+  std::vector<RenderRequest> m_queue;
+
+  /// The index of the next request in @ref m_queue to issue.
+  size_t m_next = 0;
+
+  std::vector<OutstandingRequest> m_outstanding;
+
+  size_t m_outstanding_bytes = 0;
+
+  size_t m_max_requests;
+
+  size_t m_max_bytes;
+};
+
+} // namespace vision::gui
@@ -0,0 +1,291 @@
+#include <gtest/gtest.h>
+
+#include "id_generator.hpp"
+#include "request_window.hpp"
+#include "schedule.hpp"
+
+using namespace vision::gui;
+
+namespace {
+
+Schedule
+MakeSchedule(size_t w, size_t h, size_t div_level, IDGenerator& id_generator)
+{
+  return Schedule(w, h, div_level, id_generator);
+}
+
+} // namespace
+
+TEST(RequestWindow, LimitsRequestCount)
+{
+  IDGenerator id_generator;
+
+  const Schedule schedule = MakeSchedule(64, 64, 1, id_generator);
+
+  ASSERT_EQ(schedule.GetRenderRequestCount(), size_t(4));
+
+  RequestWindow window(2, 0);
+
+  window.Queue(schedule);
+
+  RenderRequest req;
+
+  EXPECT_TRUE(window.TakeNext(req));
+  EXPECT_EQ(req.id, schedule.GetRenderRequest(0).id);
+
+  EXPECT_TRUE(window.TakeNext(req));
+  EXPECT_EQ(req.id, schedule.GetRenderRequest(1).id);
+
+  EXPECT_FALSE(window.TakeNext(req));
+
+  EXPECT_EQ(window.GetOutstandingCount(), size_t(2));
+  EXPECT_EQ(window.GetQueuedCount(), size_t(2));
+
+  EXPECT_TRUE(window.Complete(schedule.GetRenderRequest(1).id));
+
+  EXPECT_TRUE(window.TakeNext(req));
+  EXPECT_EQ(req.id, schedule.GetRenderRequest(2).id);
+
+  EXPECT_FALSE(window.TakeNext(req));
+}
+
+TEST(RequestWindow, LimitsBytes)
+{
+  IDGenerator id_generator;
+
+  const Schedule schedule = MakeSchedule(64, 64, 1, id_generator);
+
+  const size_t payload_size =
+    RequestWindow::GetPayloadSize(schedule.GetRenderRequest(0));
+
+  ASSERT_GT(payload_size, size_t(0));
+
+  RequestWindow window(0, (payload_size * 3) / 2);
+
+  window.Queue(schedule);
+
+  RenderRequest req;
+
+  EXPECT_TRUE(window.TakeNext(req));
+
+  EXPECT_FALSE(window.TakeNext(req));
+
+  EXPECT_EQ(window.GetOutstandingBytes(), payload_size);
+}
+
+TEST(RequestWindow, AllowsOneRequestOverBudget)
+{
+  IDGenerator id_generator;
+
+  const Schedule schedule = MakeSchedule(64, 64, 1, id_generator);
+
+  RequestWindow window(0, 1);
+
+  window.Queue(schedule);
+
+  RenderRequest req;
+
+  EXPECT_TRUE(window.TakeNext(req));
+
+  EXPECT_FALSE(window.TakeNext(req));
+}
+
+TEST(RequestWindow, NewFrameReplacesQueuedRequests)
+{
+  IDGenerator id_generator;
+
+  const Schedule old_schedule = MakeSchedule(64, 64, 1, id_generator);
+
+  const Schedule new_schedule = MakeSchedule(32, 32, 1, id_generator);
+
+  RequestWindow window(2, 0);
+
+  window.Queue(old_schedule);
+
+  RenderRequest req;
+
+  EXPECT_TRUE(window.TakeNext(req));
+  EXPECT_TRUE(window.TakeNext(req));
+
+  window.Queue(new_schedule);
+
+  EXPECT_EQ(window.GetQueuedCount(), new_schedule.GetRenderRequestCount());
+
+  // The requests of the old frame still hold their credit until they are
+  // replied to.
+  EXPECT_FALSE(window.TakeNext(req));
+
+  EXPECT_TRUE(window.Complete(old_schedule.GetRenderRequest(0).id));
+
+  EXPECT_TRUE(window.TakeNext(req));
+  EXPECT_EQ(req.id, new_schedule.GetRenderRequest(0).id);
+}
+
+TEST(RequestWindow, CompleteUnknownRequest)
+{
+  RequestWindow window;
+
+  EXPECT_FALSE(window.Complete(42));
+}
+
+TEST(RequestWindow, Unlimited)
+{
+  IDGenerator id_generator;
+
+  const Schedule schedule = MakeSchedule(64, 64, 3, id_generator);
+
+  RequestWindow window(0, 0);
+
+  window.Queue(schedule);
+
+  RenderRequest req;
+
+  size_t count = 0;
+
+  while (window.TakeNext(req))
+    count++;
+
+  EXPECT_EQ(count, schedule.GetRenderRequestCount());
+}
+
+TEST(RequestWindow, CancelBefore)
+{
+  IDGenerator id_generator;
+
+  const Schedule old_schedule = MakeSchedule(64, 64, 1, id_generator);
+
+  const Schedule new_schedule = MakeSchedule(64, 64, 1, id_generator);
+
+  RequestWindow window(4, 0);
+
+  window.Queue(old_schedule);
+
+  RenderRequest req;
+
+  while (window.TakeNext(req))
+    continue;
+
+  EXPECT_EQ(window.GetOutstandingCount(), size_t(4));
+
+  window.Queue(new_schedule);
+
+  window.CancelBefore(new_schedule.GetRenderRequest(0).id);
+
+  EXPECT_EQ(window.GetOutstandingCount(), size_t(0));
+
+  EXPECT_EQ(window.GetOutstandingBytes(), size_t(0));
+
+  EXPECT_TRUE(window.TakeNext(req));
+  EXPECT_EQ(req.id, new_schedule.GetRenderRequest(0).id);
+}
+
+TEST(RequestWindow, CancelBeforeMixedSizes)
+{
+  IDGenerator id_generator;
+
+  const Schedule old_schedule = MakeSchedule(64, 64, 1, id_generator);
+
+  const Schedule new_schedule = MakeSchedule(64, 64, 2, id_generator);
+
+  const size_t old_size =
+    RequestWindow::GetPayloadSize(old_schedule.GetRenderRequest(0));
+
+  const size_t new_size =
+    RequestWindow::GetPayloadSize(new_schedule.GetRenderRequest(0));
+
+  ASSERT_NE(old_size, new_size);
+
+  RequestWindow window(0, 0);
+
+  window.Queue(old_schedule);
+
+  RenderRequest req;
+
+  EXPECT_TRUE(window.TakeNext(req));
+  EXPECT_TRUE(window.TakeNext(req));
+
+  window.Queue(new_schedule);
+
+  EXPECT_TRUE(window.TakeNext(req));
+  EXPECT_TRUE(window.TakeNext(req));
+  EXPECT_TRUE(window.TakeNext(req));
+
+  EXPECT_EQ(window.GetOutstandingBytes(), (2 * old_size) + (3 * new_size));
+
+  window.CancelBefore(new_schedule.GetRenderRequest(0).id);
+
+  EXPECT_EQ(window.GetOutstandingCount(), size_t(3));
+
+  EXPECT_EQ(window.GetOutstandingBytes(), 3 * new_size);
+
+  for (size_t i = 0; i < 3; i++)
+    EXPECT_TRUE(window.Complete(new_schedule.GetRenderRequest(i).id));
+
+  EXPECT_EQ(window.GetOutstandingBytes(), size_t(0));
+}
+
+TEST(RequestWindow, SkipsCompleteRequests)
+{
+  IDGenerator id_generator;
+
+  Schedule schedule = MakeSchedule(64, 64, 1, id_generator);
+
+  schedule.CompleteRenderRequest(0);
+  schedule.CompleteRenderRequest(2);
+
+  RequestWindow window(0, 0);
+
+  window.Queue(schedule);
+
+  EXPECT_EQ(window.GetQueuedCount(), size_t(2));
+
+  RenderRequest req;
+
+  EXPECT_TRUE(window.TakeNext(req));
+  EXPECT_EQ(req.id, schedule.GetRenderRequest(1).id);
+
+  EXPECT_TRUE(window.TakeNext(req));
+  EXPECT_EQ(req.id, schedule.GetRenderRequest(3).id);
+
+  EXPECT_FALSE(window.TakeNext(req));
+}
+
+TEST(RequestWindow, Reissue)
+{
+  IDGenerator id_generator;
+
+  const Schedule schedule = MakeSchedule(64, 64, 1, id_generator);
+
+  RequestWindow window(2, 0);
+
+  window.Queue(schedule);
+
+  RenderRequest req;
+
+  ASSERT_TRUE(window.TakeNext(req));
+  ASSERT_TRUE(window.TakeNext(req));
+
+  EXPECT_TRUE(window.Complete(schedule.GetRenderRequest(0).id));
+
+  ASSERT_TRUE(window.TakeNext(req));
+
+  // The replies to requests 1 and 2 are lost.
+  window.Reissue();
+
+  EXPECT_EQ(window.GetOutstandingCount(), size_t(0));
+  EXPECT_EQ(window.GetOutstandingBytes(), size_t(0));
+  EXPECT_EQ(window.GetQueuedCount(), size_t(3));
+
+  EXPECT_TRUE(window.TakeNext(req));
+  EXPECT_EQ(req.id, schedule.GetRenderRequest(1).id);
+
+  EXPECT_TRUE(window.TakeNext(req));
+  EXPECT_EQ(req.id, schedule.GetRenderRequest(2).id);
+
+  EXPECT_FALSE(window.TakeNext(req));
+
+  EXPECT_TRUE(window.Complete(schedule.GetRenderRequest(1).id));
+
+  EXPECT_TRUE(window.TakeNext(req));
+  EXPECT_EQ(req.id, schedule.GetRenderRequest(3).id);
+}
@@ -1,13 +1,15 @@
 #include "response.hpp"
 
+#include "frame_header.hpp"
 #include "lexer.hpp"
 
 #include <algorithm>
+#include <charconv>
 #include <optional>
-#include <string>
 #include <vector>
 
 #include <stddef.h>
+#include <string.h>
 
 namespace vision::gui {
 
@@ -34,151 +36,680 @@ private:
   std::vector<Token> m_tokens;
 };
 
+/// A contiguous receive buffer. Consumed bytes are released from the front by
+/// advancing an offset, and the remaining bytes are only moved back to the
+/// front when there is not enough room at the end for incoming data. This keeps
+/// every message contiguous, so that payloads can be handed out in place.
+class ReceiveBuffer final
+{
+public:
+  const char* Data() const noexcept { return m_data.data() + m_begin; }
+
+  size_t Size() const noexcept { return m_end - m_begin; }
+
+  bool Empty() const noexcept { return m_begin == m_end; }
+
+  /// @return The number of bytes that were either copied or moved in order to
+  ///         append the data.
+  size_t Append(const char* data, size_t length)
+  {
+    if (!length)
+      return 0;
+
+    size_t copied = length;
+
+    if ((m_data.size() - m_end) < length)
+      copied += Compact();
+
+    if ((m_data.size() - m_end) < length) {
+      copied += Size();
+      m_data.resize(std::max(m_end + length, m_data.size() * 2));
+    }
+
+    memcpy(m_data.data() + m_end, data, length);
+
+    m_end += length;
+
+    return copied;
+  }
+
+  void Consume(size_t size) noexcept
+  {
+    m_begin += std::min(size, Size());
+
+    if (m_begin == m_end)
+      Clear();
+  }
+
+  void Clear() noexcept
+  {
+    m_begin = 0;
+    m_end = 0;
+  }
+
+private:
+  /// @return The number of bytes that were moved.
+  size_t Compact() noexcept
+  {
+    if (!m_begin)
+      return 0;
+
+    const size_t size = Size();
+
+    memmove(m_data.data(), m_data.data() + m_begin, size);
+
+    m_begin = 0;
+    m_end = size;
+
+    return size;
+  }
+
+private:
+  std::vector<char> m_data;
+
+  size_t m_begin = 0;
+
+  size_t m_end = 0;
+};
+
+auto
+ParseInt(const std::string_view& str) -> std::optional<long long int>
+{
+  long long int value = 0;
+
+  const char* end = str.data() + str.size();
+
+  const auto result = std::from_chars(str.data(), end, value);
+
+  if (result.ec != std::errc())
+    return std::nullopt;
+
+  return value;
+}
+
 class ResponseParserImpl final : public ResponseParser
 {
 public:
   ResponseParserImpl(ResponseObserver& o)
     : m_observer(o)
+  {}
+
+  bool Write(const char* data, size_t length) override
+  {
+    m_statistics.bytes_received += length;
+
+    m_invalid_input = false;
+
+    // Something is pending from the last write. Only as much of the input as
+    // is needed to complete it is added to the receive buffer, so that the
+    // rest of the input can be parsed in place.
+    while (!m_buffer.Empty() && length) {
+
+      const size_t top_up = GetPendingSize(data, length);
+
+      if (!Retain(data, top_up))
+        return false;
+
+      data += top_up;
+
+      length -= top_up;
+
+      m_buffer.Consume(ParseMessages(m_buffer.Data(), m_buffer.Size()));
+
+      if (m_invalid_input)
+        return true;
+    }
+
+    if (!m_buffer.Empty())
+      return true;
+
+    const size_t consumed = ParseMessages(data, length);
+
+    return Retain(data + consumed, length - consumed);
+  }
+
+  void SetMaxBufferSize(size_t max_size) override { m_buffer_max = max_size; }
+
+  size_t GetMaxBufferSize() const noexcept override { return m_buffer_max; }
+
+  void SetSharedPayloadSource(SharedPayloadSource* source) override
   {
-    m_buffer.reserve(m_buffer_max);
+    m_shared_payloads = source;
   }
 
-  bool Write(const char* data, size_t length) override
+  auto GetStatistics() const noexcept -> ResponseParserStatistics override
   {
-    if ((m_buffer.size() + length) > m_buffer_max) {
-      m_observer.OnBufferOverflow(m_buffer_max);
-      m_buffer.clear();
-      return false;
+    return m_statistics;
+  }
+
+private:
+  /// Describes an RGB buffer that is being passed to the observer row by row.
+  struct RowStream final
+  {
+    size_t width = 0;
+
+    size_t height = 0;
+
+    size_t request_id = 0;
+
+    size_t next_row = 0;
+
+    size_t GetRowSize() const noexcept { return width * 3; }
+  };
+
+  /// Describes an RGB buffer that is being written to a destination chosen by
+  /// the observer.
+  struct DirectPayload final
+  {
+    unsigned char* destination = nullptr;
+
+    size_t width = 0;
+
+    size_t height = 0;
+
+    size_t request_id = 0;
+
+    size_t written = 0;
+
+    size_t GetSize() const noexcept { return width * height * 3; }
+  };
+
+  /// Determines how many bytes of the input are needed to complete whatever
+  /// is pending in the receive buffer. That is either a partial row of a
+  /// streamed RGB buffer or a partial header. If the header is already
+  /// complete and the observer does not take rows, the payload has to be
+  /// buffered as a whole.
+  size_t GetPendingSize(const char* data, size_t length) const noexcept
+  {
+    const size_t buffered = m_buffer.Size();
+
+    if (m_skip_remaining)
+      return std::min(length, m_skip_remaining);
+
+    if (m_direct_payload) {
+      const size_t remaining =
+        m_direct_payload->GetSize() - m_direct_payload->written;
+      return std::min(length, remaining);
     }
 
-    size_t old_size = m_buffer.size();
+    if (m_row_stream)
+      return std::min(length, m_row_stream->GetRowSize() - buffered);
+
+    if (m_binary_protocol) {
 
-    m_buffer.resize(old_size + length);
+      if (buffered >= FrameHeader::encoded_size)
+        return length;
+
+      return std::min(length, FrameHeader::encoded_size - buffered);
+    }
 
-    for (size_t i = 0; i < length; i++)
-      m_buffer[old_size + i] = data[i];
+    if (!GetLine(m_buffer.Data(), buffered).empty())
+      return length;
 
-    ParseBuffer();
+    const void* newline = memchr(data, '\n', length);
+
+    if (!newline)
+      return length;
+
+    return ((const char*)newline - data) + 1;
+  }
+
+  bool Retain(const char* data, size_t length)
+  {
+    if ((m_buffer.Size() + length) > m_buffer_max) {
+      m_observer.OnBufferOverflow(m_buffer_max);
+      m_buffer.Clear();
+      return false;
+    }
+
+    m_statistics.bytes_copied += m_buffer.Append(data, length);
 
     return true;
   }
 
-  void SetMaxBufferSize(size_t max_size) override
+  /// Parses messages until there are no complete messages left, then passes
+  /// the RGB buffers that were found to the observer in one batch.
+  ///
+  /// @return The number of bytes that were consumed.
+  size_t ParseMessages(const char* data, size_t size)
   {
-    m_buffer_max = max_size;
+    size_t offset = 0;
+
+    while (offset < size) {
+
+      const size_t consumed = ParseBuffer(data + offset, size - offset);
+
+      if (!consumed)
+        break;
+
+      offset += consumed;
+    }
 
-    m_buffer.reserve(max_size);
+    FlushRGBBuffers();
+
+    return offset;
   }
 
-  size_t GetMaxBufferSize() const noexcept override { return m_buffer_max; }
+  void FlushRGBBuffers()
+  {
+    if (!m_rgb_buffers.empty()) {
 
-private:
-  bool ParseBuffer()
+      m_observer.OnRGBBuffers(m_rgb_buffers.data(), m_rgb_buffers.size());
+
+      m_rgb_buffers.clear();
+    }
+
+    if (m_shared_release) {
+      m_shared_payloads->Release(*m_shared_release);
+      m_shared_release.reset();
+    }
+  }
+
+  /// Parses a message at the beginning of the given data.
+  ///
+  /// @return The number of bytes that were consumed. This is zero if the
+  ///         message is not complete yet.
+  size_t ParseBuffer(const char* data, size_t size)
   {
-    std::string line = GetLine();
+    if (m_skip_remaining)
+      return Skip(size);
+
+    if (m_direct_payload)
+      return WriteDirectPayload(data, size);
+
+    if (m_row_stream)
+      return ParseRows(data, size);
+
+    if (m_binary_protocol)
+      return ParseFrame(data, size);
+
+    const std::string_view line = GetLine(data, size);
 
     if (line.empty())
-      return false;
+      return 0;
 
     TokenBuffer tokens = GetLineTokens(line);
 
     if (tokens.Empty())
-      return false;
+      return line.size();
 
-    if (ParseRGBBuffer(line, tokens)) {
-      return true;
-    } else {
-      HandleInvalidInput("Header line is not recognizable.");
-      return false;
-    }
+    std::optional<size_t> consumed = ParseRGBBuffer(line, tokens, data, size);
+
+    if (consumed)
+      return *consumed;
+
+    consumed = ParseProtocol(line, tokens, size);
+
+    if (consumed)
+      return *consumed;
+
+    return HandleInvalidInput("Header line is not recognizable.", size);
   }
 
-  bool ParseRGBBuffer(const std::string& line, const TokenBuffer& tokens)
+  /// @return If the header is not an RGB buffer header, then a null optional is
+  ///         returned. Otherwise, the number of bytes consumed.
+  auto ParseRGBBuffer(const std::string_view& line,
+                      const TokenBuffer& tokens,
+                      const char* data,
+                      size_t size) -> std::optional<size_t>
   {
     if (tokens[0] != "rgb")
-      return false;
+      return std::nullopt;
 
     if (tokens[1] != "buffer")
-      return false;
+      return std::nullopt;
 
     if (tokens.Size() < 3) {
-      HandleInvalidInput("Width, height and request ID are missing.");
-      return true;
+      return HandleInvalidInput("Width, height and request ID are missing.",
+                                size);
     } else if (tokens.Size() < 4) {
-      HandleInvalidInput("Height and request ID are missing.");
-      return true;
+      return HandleInvalidInput("Height and request ID are missing.", size);
     } else if (tokens.Size() < 5) {
-      HandleInvalidInput("Request ID is missing.");
-      return true;
+      return HandleInvalidInput("Request ID is missing.", size);
     }
 
-    if (tokens[2] != TokenKind::Int) {
-      HandleInvalidInput("Width is not an integer.");
-    } else if (tokens[3] != TokenKind::Int) {
-      HandleInvalidInput("Height is not an integer.");
-      return true;
-    } else if (tokens[4] != TokenKind::Int) {
-      HandleInvalidInput("Request ID is not an integer.");
-      return true;
+    const std::optional<long long int> w = ParseInt(tokens[2]->data);
+    const std::optional<long long int> h = ParseInt(tokens[3]->data);
+    const std::optional<long long int> id = ParseInt(tokens[4]->data);
+
+    if ((tokens[2] != TokenKind::Int) || !w) {
+      return HandleInvalidInput("Width is not an integer.", size);
+    } else if ((tokens[3] != TokenKind::Int) || !h) {
+      return HandleInvalidInput("Height is not an integer.", size);
+    } else if ((tokens[4] != TokenKind::Int) || !id) {
+      return HandleInvalidInput("Request ID is not an integer.", size);
     }
 
-    if (tokens.Size() != 5) {
-      HandleInvalidInput("Trailing tokens after request ID.");
-      return true;
+    if (tokens.Size() != 5)
+      return HandleInvalidInput("Trailing tokens after request ID.", size);
+
+    if (*w < 0) {
+      return HandleInvalidInput("Width is negative.", size);
+    } else if (*h < 0) {
+      return HandleInvalidInput("Height is negative.", size);
+    } else if (*id < 0) {
+      return HandleInvalidInput("Request ID is negative.", size);
     }
 
-    const std::string w_str(std::string(tokens[2]->data));
-    const std::string h_str(std::string(tokens[3]->data));
-    const std::string id_str(std::string(tokens[4]->data));
+    const size_t rgb_buffer_size = size_t(*w) * size_t(*h) * 3;
 
-    const int w = std::atoi(w_str.c_str());
-    const int h = std::atoi(h_str.c_str());
-    const int id = std::atoi(id_str.c_str());
+    if (m_observer.IsStale(size_t(*id)))
+      return SkipPayload(line.size(), rgb_buffer_size, size);
 
-    if (w < 0) {
-      HandleInvalidInput("Width is negative.");
-      return true;
-    } else if (h < 0) {
-      HandleInvalidInput("Height is negative.");
-      return true;
-    } else if (id < 0) {
-      HandleInvalidInput("Request ID is negative.");
-      return true;
+    unsigned char* destination =
+      m_observer.GetPayloadDestination(size_t(*w), size_t(*h), size_t(*id));
+
+    if (destination) {
+      m_direct_payload =
+        DirectPayload{ destination, size_t(*w), size_t(*h), size_t(*id), 0 };
+      return line.size() + WriteDirectPayload(data + line.size(),
+                                              size - line.size());
     }
 
-    size_t rgb_buffer_size = w * h * 3;
+    if ((size - line.size()) < rgb_buffer_size) {
 
-    if (line.size() > m_buffer.size()) {
-      // This is not really likely, just a safety check.
-      return true;
+      if (!BeginRowStream(size_t(*w), size_t(*h), size_t(*id)))
+        return 0;
+
+      return line.size();
     }
 
-    if ((m_buffer.size() - line.size()) < rgb_buffer_size)
-      return true;
+    const unsigned char* rgb_ptr = (const unsigned char*)(data + line.size());
+
+    m_rgb_buffers.emplace_back(
+      RGBPayload{ rgb_ptr, size_t(*w), size_t(*h), size_t(*id) });
+
+    m_statistics.payload_bytes += rgb_buffer_size;
+
+    return line.size() + rgb_buffer_size;
+  }
+
+  /// Parses the line a renderer sends to switch to another protocol version.
+  ///
+  /// @return If the line is not a protocol line, then a null optional is
+  ///         returned. Otherwise, the number of bytes consumed.
+  auto ParseProtocol(const std::string_view& line,
+                     const TokenBuffer& tokens,
+                     size_t size) -> std::optional<size_t>
+  {
+    if (tokens[0] != "protocol")
+      return std::nullopt;
+
+    if (tokens.Size() != 2)
+      return HandleInvalidInput("Protocol line should have one version.", size);
+
+    const std::optional<long long int> version = ParseInt(tokens[1]->data);
+
+    if ((tokens[1] != TokenKind::Int) || !version)
+      return HandleInvalidInput("Protocol version is not an integer.", size);
+
+    if (*version != 2)
+      return HandleInvalidInput("Protocol version is not supported.", size);
+
+    m_binary_protocol = true;
+
+    return line.size();
+  }
+
+  /// Parses a message of the binary protocol. Since the header has a fixed
+  /// size and contains the payload size, there is no scanning involved.
+  ///
+  /// @return The number of bytes consumed.
+  size_t ParseFrame(const char* data, size_t size)
+  {
+    if (size < FrameHeader::encoded_size)
+      return 0;
+
+    const FrameHeader header =
+      DecodeFrameHeader((const unsigned char*)data);
+
+    if (header.magic != FrameHeader::magic_number)
+      return HandleInvalidInput("Frame header has an invalid magic number.",
+                                size);
+
+    const size_t frame_size = FrameHeader::encoded_size + header.payload_size;
+
+    if (header.type == FrameType::SharedRGBBuffer)
+      return ParseSharedFrame(header, data, size);
+
+    // Unknown frame types are skipped, so that renderers may send messages
+    // that are only understood by newer versions of the program.
+    if (header.type != FrameType::RGBBuffer) {
+
+      if ((size - FrameHeader::encoded_size) < header.payload_size)
+        return 0;
+
+      return frame_size;
+    }
+
+    if (header.pixel_format != PixelFormat::RGB888)
+      return HandleInvalidInput("Pixel format is not supported.", size);
+
+    const size_t w = header.width;
+    const size_t h = header.height;
+
+    if (header.payload_size != (w * h * 3))
+      return HandleInvalidInput("Payload size does not match the frame size.",
+                                size);
+
+    if (m_observer.IsStale(size_t(header.request_id)))
+      return SkipPayload(FrameHeader::encoded_size, header.payload_size, size);
+
+    const size_t id = size_t(header.request_id);
+
+    unsigned char* destination = m_observer.GetPayloadDestination(w, h, id);
+
+    if (destination) {
+      m_direct_payload = DirectPayload{ destination, w, h, id, 0 };
+      return FrameHeader::encoded_size +
+             WriteDirectPayload(data + FrameHeader::encoded_size,
+                                size - FrameHeader::encoded_size);
+    }
+
+    if ((size - FrameHeader::encoded_size) < header.payload_size) {
+
+      if (!BeginRowStream(w, h, size_t(header.request_id)))
+        return 0;
+
+      return FrameHeader::encoded_size;
+    }
+
+    const unsigned char* rgb_ptr =
+      (const unsigned char*)(data + FrameHeader::encoded_size);
+
+    m_rgb_buffers.emplace_back(
+      RGBPayload{ rgb_ptr, w, h, size_t(header.request_id) });
+
+    m_statistics.payload_bytes += header.payload_size;
+
+    return frame_size;
+  }
+
+  /// Parses a frame whose pixels are in shared memory. The memory is released
+  /// back to the renderer once the batch it is in has been passed to the
+  /// observer.
+  size_t ParseSharedFrame(const FrameHeader& header,
+                          const char* data,
+                          size_t size)
+  {
+    if (header.pixel_format != PixelFormat::RGB888)
+      return HandleInvalidInput("Pixel format is not supported.", size);
+
+    if (header.payload_size != shared_payload_location_size)
+      return HandleInvalidInput("Shared frame payload is not a position.",
+                                size);
+
+    const size_t frame_size =
+      FrameHeader::encoded_size + shared_payload_location_size;
+
+    if (size < frame_size)
+      return 0;
+
+    if (!m_shared_payloads)
+      return HandleInvalidInput("Shared frame received without shared memory.",
+                                size);
+
+    const uint64_t position = detail::DecodeLittleEndian<uint64_t>(
+      (const unsigned char*)(data + FrameHeader::encoded_size));
+
+    const size_t w = header.width;
+    const size_t h = header.height;
+    const size_t rgb_buffer_size = w * h * 3;
+
+    const unsigned char* rgb_ptr =
+      m_shared_payloads->GetPayload(position, rgb_buffer_size);
+
+    if (!rgb_ptr)
+      return HandleInvalidInput("Shared frame is out of range.", size);
+
+    m_shared_release = position + rgb_buffer_size;
+
+    if (m_observer.IsStale(size_t(header.request_id))) {
+      m_statistics.skipped_bytes += rgb_buffer_size;
+      return frame_size;
+    }
 
-    std::vector<char> rgb_buf(m_buffer.begin() + line.size(), m_buffer.end());
+    m_rgb_buffers.emplace_back(
+      RGBPayload{ rgb_ptr, w, h, size_t(header.request_id) });
 
-    const unsigned char* rgb_ptr = (const unsigned char*)rgb_buf.data();
+    m_statistics.payload_bytes += rgb_buffer_size;
 
-    m_observer.OnRGBBuffer(rgb_ptr, size_t(w), size_t(h), size_t(id));
+    return frame_size;
+  }
+
+  /// Skips the payload of a stale reply. Whatever part of the payload is not
+  /// in the data yet is skipped as it arrives, without being buffered.
+  ///
+  /// @param header_size The size of the header preceding the payload.
+  ///
+  /// @return The number of bytes consumed.
+  size_t SkipPayload(size_t header_size, size_t payload_size, size_t size)
+  {
+    const size_t available = std::min(size - header_size, payload_size);
+
+    m_skip_remaining = payload_size - available;
+
+    m_statistics.skipped_bytes += available;
+
+    return header_size + available;
+  }
+
+  /// Skips the rest of a stale payload.
+  ///
+  /// @return The number of bytes consumed.
+  size_t Skip(size_t size)
+  {
+    const size_t skipped = std::min(size, m_skip_remaining);
+
+    m_skip_remaining -= skipped;
+
+    m_statistics.skipped_bytes += skipped;
+
+    return skipped;
+  }
+
+  /// Copies as much of a payload as is available to the destination chosen
+  /// by the observer. Once the payload is complete, the destination is added
+  /// to the RGB buffers of the current write.
+  ///
+  /// @return The number of bytes consumed.
+  size_t WriteDirectPayload(const char* data, size_t size)
+  {
+    DirectPayload& payload = *m_direct_payload;
+
+    const size_t length = std::min(size, payload.GetSize() - payload.written);
+
+    memcpy(payload.destination + payload.written, data, length);
 
-    Advance(line.size(), rgb_buffer_size);
+    payload.written += length;
+
+    m_statistics.direct_bytes += length;
+
+    if (payload.written < payload.GetSize())
+      return length;
+
+    m_rgb_buffers.emplace_back(RGBPayload{
+      payload.destination, payload.width, payload.height, payload.request_id });
+
+    m_statistics.payload_bytes += payload.GetSize();
+
+    m_direct_payload.reset();
+
+    return length;
+  }
+
+  /// Starts passing an RGB buffer to the observer row by row, if the observer
+  /// supports it. This is done for buffers that are not received in one
+  /// write, so that only a partial row has to be buffered.
+  ///
+  /// @return True if the rows are streamed, false if the buffer has to be
+  ///         received as a whole.
+  bool BeginRowStream(size_t w, size_t h, size_t request_id)
+  {
+    if (!m_observer.SupportsRows())
+      return false;
+
+    m_row_stream = RowStream{ w, h, request_id, 0 };
 
     return true;
   }
 
-  void EraseBufferPrefix(size_t size)
+  /// Passes the complete rows at the beginning of the data to the observer.
+  ///
+  /// @return The number of bytes consumed.
+  size_t ParseRows(const char* data, size_t size)
   {
-    size = std::min(size, m_buffer.size());
+    const size_t row_size = m_row_stream->GetRowSize();
+
+    const size_t rows_left = m_row_stream->height - m_row_stream->next_row;
+
+    const size_t row_count = std::min(size / row_size, rows_left);
+
+    if (!row_count)
+      return 0;
+
+    // Buffers that were completed before these rows go first.
+    FlushRGBBuffers();
+
+    const RGBRowRange rows{ (const unsigned char*)data,
+                            m_row_stream->width,
+                            m_row_stream->height,
+                            m_row_stream->request_id,
+                            m_row_stream->next_row,
+                            row_count };
 
-    m_buffer.erase(m_buffer.begin(), m_buffer.begin() + size);
+    m_row_stream->next_row += row_count;
+
+    if (m_row_stream->next_row >= m_row_stream->height)
+      m_row_stream.reset();
+
+    m_observer.OnRGBRows(rows);
+
+    m_statistics.payload_bytes += row_count * row_size;
+
+    return row_count * row_size;
   }
 
-  void HandleInvalidInput(const std::string_view& reason)
+  /// @return The number of bytes to drop, which is always the remainder of the
+  ///         input since there is no way to resynchronize with the stream.
+  size_t HandleInvalidInput(const std::string_view& reason, size_t size)
   {
-    m_buffer.clear();
+    // Whatever was received before the invalid input is still valid.
+    FlushRGBBuffers();
+
+    m_buffer.Clear();
+
+    m_row_stream.reset();
+
+    m_direct_payload.reset();
+
+    m_skip_remaining = 0;
+
+    m_invalid_input = true;
 
     m_observer.OnInvalidResponse(reason);
+
+    return size;
   }
 
   TokenBuffer GetLineTokens(const std::string_view& line)
@@ -202,57 +733,75 @@ private:
     return tokens;
   }
 
-  std::string GetLine() const
+  /// @return The header line, including the newline character. If the line is
+  ///         not complete yet, then an empty string is returned.
+  static std::string_view GetLine(const char* data, size_t size) noexcept
   {
-    std::vector<char>::const_iterator it =
-      std::find(m_buffer.begin(), m_buffer.end(), '\n');
+    if (!size)
+      return std::string_view();
 
-    if (it == m_buffer.end())
-      return std::string();
+    const void* newline = memchr(data, '\n', size);
 
-    size_t length = std::distance(m_buffer.begin(), it) + 1;
+    if (!newline)
+      return std::string_view();
 
-    std::string line;
+    return std::string_view(data, ((const char*)newline - data) + 1);
+  }
 
-    for (size_t i = 0; i < length; i++)
-      line.push_back(m_buffer.at(i));
+private:
+  ResponseObserver& m_observer;
 
-    return line;
-  }
+  /// Beyond this amount of buffered data (16 MiB), the input is considered to
+  /// be invalid. Unless the observer takes RGB buffers row by row, this also
+  /// limits the size of an RGB buffer.
+  size_t m_buffer_max = 16777216;
 
-  char Peek(size_t offset) const noexcept
-  {
-    if (offset >= m_buffer.size())
-      return 0;
-    else
-      return m_buffer[offset];
-  }
+  ReceiveBuffer m_buffer;
 
-  bool OutOfBounds(size_t index) const noexcept
-  {
-    return index >= m_buffer.size();
-  }
+  ResponseParserStatistics m_statistics;
 
-  void Advance(size_t line_size, size_t data_size)
-  {
-    const size_t total_size = line_size + data_size;
+  /// Whether or not the renderer switched to the binary protocol.
+  bool m_binary_protocol = false;
 
-    const size_t clipped_size = std::min(total_size, m_buffer.size());
+  /// Set when invalid input is found, so that the rest of the write is
+  /// dropped.
+  bool m_invalid_input = false;
 
-    m_buffer.erase(m_buffer.begin(), m_buffer.begin() + clipped_size);
-  }
+  /// The RGB buffer currently being passed to the observer row by row.
+  std::optional<RowStream> m_row_stream;
 
-private:
-  ResponseObserver& m_observer;
+  /// The RGB buffer currently being written to a destination chosen by the
+  /// observer.
+  std::optional<DirectPayload> m_direct_payload;
 
-  /// Beyond this response size (16 MiB) is considered to be invalid.
-  size_t m_buffer_max = 16777216;
+  /// The number of bytes left of a stale payload that is being skipped.
+  size_t m_skip_remaining = 0;
 
-  std::vector<char> m_buffer;
+  /// The RGB buffers found by the current write, which point into either the
+  /// input, the receive buffer, the shared memory or a destination chosen by
+  /// the observer.
+  std::vector<RGBPayload> m_rgb_buffers;
+
+  SharedPayloadSource* m_shared_payloads = nullptr;
+
+  /// The end of the last shared payload in @ref m_rgb_buffers, which is
+  /// released once they have been passed to the observer.
+  std::optional<uint64_t> m_shared_release;
 };
 
 } // namespace
 
+void
+ResponseObserver::OnRGBBuffers(const RGBPayload* buffers, size_t count)
+{
+  for (size_t i = 0; i < count; i++) {
+
+    const RGBPayload& buffer = buffers[i];
+
+    OnRGBBuffer(buffer.data, buffer.width, buffer.height, buffer.request_id);
+  }
+}
+
 auto
 ResponseParser::Create(ResponseObserver& observer)
   -> std::unique_ptr<ResponseParser>
@@ -4,9 +4,43 @@
 #include <string_view>
 
 #include <stddef.h>
+#include <stdint.h>
 
 namespace vision::gui {
 
+/// Describes an RGB buffer received from the renderer.
+struct RGBPayload final
+{
+  const unsigned char* data = nullptr;
+
+  size_t width = 0;
+
+  size_t height = 0;
+
+  size_t request_id = 0;
+};
+
+/// Describes a range of rows of an RGB buffer that is received incrementally.
+struct RGBRowRange final
+{
+  /// Points to the first byte of the first row in the range.
+  const unsigned char* data = nullptr;
+
+  /// The width of the RGB buffer, in pixels.
+  size_t width = 0;
+
+  /// The height of the whole RGB buffer, in pixels.
+  size_t height = 0;
+
+  size_t request_id = 0;
+
+  /// The index of the first row in the range.
+  size_t first_row = 0;
+
+  /// The number of rows in the range.
+  size_t row_count = 0;
+};
+
 class ResponseObserver
 {
 public:
@@ -18,10 +52,106 @@ public:
   /// to be a valid response.
   virtual void OnBufferOverflow(size_t buffer_max) = 0;
 
+  /// Called when a complete RGB buffer is received.
+  ///
+  /// @param buffer Points directly into either the chunk passed to @ref
+  ///               ResponseParser::Write or the parser's receive storage. It is
+  ///               only valid for the duration of the call.
   virtual void OnRGBBuffer(const unsigned char* buffer,
                            size_t width,
                            size_t height,
                            size_t request_id) = 0;
+
+  /// Called once per write with every RGB buffer that was completed by it. The
+  /// default implementation passes each buffer to @ref OnRGBBuffer.
+  ///
+  /// @param buffers The RGB buffers, in the order they were received. The data
+  ///                is only valid for the duration of the call.
+  ///
+  /// @param count The number of RGB buffers.
+  virtual void OnRGBBuffers(const RGBPayload* buffers, size_t count);
+
+  /// Indicates whether or not the observer can take RGB buffers row by row,
+  /// through @ref OnRGBRows. If it can, RGB buffers that are not received in a
+  /// single write are passed on as their rows arrive, and the parser only has
+  /// to keep a partial row. Otherwise the parser keeps the whole buffer until
+  /// it is complete, which is limited by the maximum buffer size.
+  virtual bool SupportsRows() const { return false; }
+
+  /// Called with the rows of an RGB buffer as they are received. The rows of a
+  /// buffer are passed in order, and the buffer is complete once the last row
+  /// has been passed. Only called if @ref SupportsRows returns true.
+  ///
+  /// @param rows The range of rows. The data is only valid for the duration of
+  ///             the call.
+  virtual void OnRGBRows(const RGBRowRange& rows) { (void)rows; }
+
+  /// Lets the observer choose where the payload of an RGB buffer is written,
+  /// such as into staging memory for the GPU. If a destination is returned,
+  /// the payload is copied there as it arrives, which is the only copy the
+  /// parser makes of it, and the destination is passed to @ref OnRGBBuffer
+  /// once the payload is complete. This takes precedence over @ref OnRGBRows.
+  /// Payloads of shared frames are already in memory and are not copied.
+  ///
+  /// @return A destination that can hold the width times the height times
+  ///         three bytes of the payload, or null to leave the payload to the
+  ///         parser. It has to remain valid until the payload is complete.
+  virtual auto GetPayloadDestination(size_t width,
+                                     size_t height,
+                                     size_t request_id) -> unsigned char*
+  {
+    (void)width;
+    (void)height;
+    (void)request_id;
+    return nullptr;
+  }
+
+  /// Indicates whether the reply to a request is no longer needed, such as
+  /// when it belongs to a frame that was replaced. The payload of a stale
+  /// reply is skipped as it arrives, without being buffered or passed on.
+  virtual bool IsStale(size_t request_id) const
+  {
+    (void)request_id;
+    return false;
+  }
+};
+
+/// Counters kept by the parser, mainly to keep an eye on how often payload
+/// bytes get moved around before they reach the observer.
+struct ResponseParserStatistics final
+{
+  /// The number of bytes passed to @ref ResponseParser::Write.
+  size_t bytes_received = 0;
+
+  /// The number of payload bytes handed to the observer.
+  size_t payload_bytes = 0;
+
+  /// The number of bytes the parser copied or moved within its own storage.
+  size_t bytes_copied = 0;
+
+  /// The number of payload bytes skipped because their reply was stale.
+  size_t skipped_bytes = 0;
+
+  /// The number of payload bytes written to destinations chosen by the
+  /// observer.
+  size_t direct_bytes = 0;
+};
+
+/// Resolves the payloads of shared frames, which a renderer writes into
+/// memory that is shared with this process instead of into the stream.
+class SharedPayloadSource
+{
+public:
+  virtual ~SharedPayloadSource() = default;
+
+  /// @return A pointer to the payload at the given position, or null if the
+  ///         range is not valid.
+  virtual auto GetPayload(uint64_t position, size_t size)
+    -> const unsigned char* = 0;
+
+  /// Called once the payloads that end at or before the given position have
+  /// been passed to the observer, so that the renderer may reuse the memory.
+  virtual void Release(uint64_t end_position) = 0;
 };
 
 class ResponseParser
@@ -37,6 +167,12 @@ public:
   virtual void SetMaxBufferSize(size_t max_size) = 0;
 
   virtual size_t GetMaxBufferSize() const noexcept = 0;
+
+  /// Sets where the payloads of shared frames are found. Without a source,
+  /// shared frames are treated as invalid input. The source is not owned.
+  virtual void SetSharedPayloadSource(SharedPayloadSource* source) = 0;
+
+  virtual auto GetStatistics() const noexcept -> ResponseParserStatistics = 0;
 };
 
 } // namespace vision::gui
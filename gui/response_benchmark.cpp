@@ -0,0 +1,212 @@
+#include <benchmark/benchmark.h>
+
+#include "frame_header.hpp"
+#include "response.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace vision::gui;
+
+namespace {
+
+class NullObserver final : public ResponseObserver
+{
+public:
+  void OnInvalidResponse(const std::string_view&) override {}
+
+  void OnBufferOverflow(size_t) override {}
+
+  void OnRGBBuffer(const unsigned char* rgb, size_t, size_t, size_t) override
+  {
+    benchmark::DoNotOptimize(rgb);
+  }
+};
+
+class NullRowObserver final : public ResponseObserver
+{
+public:
+  void OnInvalidResponse(const std::string_view&) override {}
+
+  void OnBufferOverflow(size_t) override {}
+
+  void OnRGBBuffer(const unsigned char* rgb, size_t, size_t, size_t) override
+  {
+    benchmark::DoNotOptimize(rgb);
+  }
+
+  bool SupportsRows() const override { return true; }
+
+  void OnRGBRows(const RGBRowRange& rows) override
+  {
+    benchmark::DoNotOptimize(rows.data);
+  }
+};
+
+/// Takes every payload into the same destination, like a staging buffer that
+/// is handed out for each reply.
+class NullDirectObserver final : public ResponseObserver
+{
+public:
+  void OnInvalidResponse(const std::string_view&) override {}
+
+  void OnBufferOverflow(size_t) override {}
+
+  void OnRGBBuffer(const unsigned char* rgb, size_t, size_t, size_t) override
+  {
+    benchmark::DoNotOptimize(rgb);
+  }
+
+  auto GetPayloadDestination(size_t w, size_t h, size_t)
+    -> unsigned char* override
+  {
+    m_destination.resize(w * h * 3);
+
+    return m_destination.data();
+  }
+
+private:
+  std::vector<unsigned char> m_destination;
+};
+
+std::string
+MakeResponseStream(size_t w, size_t h, size_t count, bool binary)
+{
+  std::string stream;
+
+  if (binary)
+    stream += "protocol 2\n";
+
+  for (size_t i = 0; i < count; i++) {
+
+    if (binary) {
+
+      FrameHeader header;
+      header.width = w;
+      header.height = h;
+      header.request_id = i;
+      header.payload_size = w * h * 3;
+
+      unsigned char header_data[FrameHeader::encoded_size];
+
+      EncodeFrameHeader(header, header_data);
+
+      stream.append((const char*)header_data, sizeof(header_data));
+
+    } else {
+
+      stream += "rgb buffer " + std::to_string(w) + ' ' + std::to_string(h);
+
+      stream += ' ' + std::to_string(i) + '\n';
+    }
+
+    stream.append(w * h * 3, char(i));
+  }
+
+  return stream;
+}
+
+/// Feeds the parser a stream of RGB buffers in fixed size chunks, similar to
+/// what a pipe read would return. The first argument is the width and height of
+/// each partition and the second argument is the chunk size.
+template<typename Observer>
+void
+ParseResponseStream(benchmark::State& state, bool binary)
+{
+  const size_t partition_size = state.range(0);
+
+  const size_t chunk_size = state.range(1);
+
+  const std::string stream =
+    MakeResponseStream(partition_size, partition_size, 64, binary);
+
+  Observer observer;
+
+  ResponseParserStatistics stats;
+
+  for (auto _ : state) {
+
+    std::unique_ptr<ResponseParser> parser = ResponseParser::Create(observer);
+
+    for (size_t offset = 0; offset < stream.size(); offset += chunk_size) {
+
+      const size_t length = std::min(chunk_size, stream.size() - offset);
+
+      parser->Write(&stream[offset], length);
+    }
+
+    stats = parser->GetStatistics();
+  }
+
+  state.SetBytesProcessed(state.iterations() * stream.size());
+
+  const size_t payload_bytes = std::max(stats.payload_bytes, size_t(1));
+
+  state.counters["copies_per_payload_byte"] =
+    double(stats.bytes_copied) / double(payload_bytes);
+
+  state.counters["direct_bytes_per_payload_byte"] =
+    double(stats.direct_bytes) / double(payload_bytes);
+}
+
+void
+BM_ResponseParser(benchmark::State& state)
+{
+  ParseResponseStream<NullObserver>(state, false);
+}
+
+void
+BM_ResponseParser_Binary(benchmark::State& state)
+{
+  ParseResponseStream<NullObserver>(state, true);
+}
+
+void
+BM_ResponseParser_Rows(benchmark::State& state)
+{
+  ParseResponseStream<NullRowObserver>(state, false);
+}
+
+void
+BM_ResponseParser_Direct(benchmark::State& state)
+{
+  ParseResponseStream<NullDirectObserver>(state, false);
+}
+
+void
+BM_ResponseParser_BinaryDirect(benchmark::State& state)
+{
+  ParseResponseStream<NullDirectObserver>(state, true);
+}
+
+BENCHMARK(BM_ResponseParser)
+  ->Args({ 1, 4096 })
+  ->Args({ 16, 4096 })
+  ->Args({ 16, 65536 })
+  ->Args({ 256, 65536 })
+  ->Args({ 1024, 65536 })
+  ->Args({ 1024, 1048576 });
+
+BENCHMARK(BM_ResponseParser_Rows)
+  ->Args({ 256, 65536 })
+  ->Args({ 1024, 65536 })
+  ->Args({ 1024, 1048576 });
+
+BENCHMARK(BM_ResponseParser_Binary)
+  ->Args({ 1, 4096 })
+  ->Args({ 16, 4096 })
+  ->Args({ 16, 65536 })
+  ->Args({ 256, 65536 });
+
+BENCHMARK(BM_ResponseParser_Direct)
+  ->Args({ 256, 65536 })
+  ->Args({ 1024, 65536 })
+  ->Args({ 1024, 1048576 });
+
+BENCHMARK(BM_ResponseParser_BinaryDirect)
+  ->Args({ 256, 65536 })
+  ->Args({ 1024, 65536 });
+
+} // namespace
@@ -0,0 +1,280 @@
+#include "response_decoder.hpp"
+
+#include <chrono>
+#include <thread>
+
+namespace vision::gui {
+
+namespace {
+
+void
+ConvertRGBToRGBA(const unsigned char* rgb,
+                 unsigned char* rgba,
+                 size_t pixel_count) noexcept
+{
+  for (size_t i = 0; i < pixel_count; i++) {
+    rgba[(i * 4) + 0] = rgb[(i * 3) + 0];
+    rgba[(i * 4) + 1] = rgb[(i * 3) + 1];
+    rgba[(i * 4) + 2] = rgb[(i * 3) + 2];
+    rgba[(i * 4) + 3] = 255;
+  }
+}
+
+auto
+MakePartition(size_t w, size_t h, size_t request_id)
+  -> std::unique_ptr<PartitionBuffer>
+{
+  std::unique_ptr<PartitionBuffer> partition(new PartitionBuffer());
+
+  partition->request_id = request_id;
+  partition->width = w;
+  partition->height = h;
+  partition->pixels.resize(w * h * 4);
+
+  return partition;
+}
+
+size_t
+GetPixelBytes(const DecodedResponse& response) noexcept
+{
+  // Pixels decoded into staging blocks count as well, since they are waiting
+  // for the consumer all the same.
+  return response.partition ? response.partition->GetSize() : 0;
+}
+
+} // namespace
+
+ResponseDecoder::ResponseDecoder(std::function<void()> notify,
+                                 size_t queue_capacity,
+                                 size_t max_queued_bytes)
+  : m_notify(std::move(notify))
+  , m_queue(queue_capacity)
+  , m_parser(ResponseParser::Create(*this))
+  , m_max_queued_bytes(max_queued_bytes)
+{}
+
+void
+ResponseDecoder::Write(const char* data, size_t length)
+{
+  m_publish_count = 0;
+
+  m_parser->Write(data, length);
+
+  if (m_publish_count && m_notify)
+    m_notify();
+}
+
+bool
+ResponseDecoder::TryPop(DecodedResponse& response)
+{
+  if (!m_queue.TryPop(response))
+    return false;
+
+  m_queued_bytes.fetch_sub(GetPixelBytes(response), std::memory_order_release);
+
+  return true;
+}
+
+void
+ResponseDecoder::Stop() noexcept
+{
+  m_stopped.store(true);
+}
+
+void
+ResponseDecoder::SetFirstCurrentRequest(size_t request_id) noexcept
+{
+  m_first_current_request.store(request_id, std::memory_order_relaxed);
+}
+
+void
+ResponseDecoder::OnInvalidResponse(const std::string_view& reason)
+{
+  // The payloads that were complete have been passed on, so any block left
+  // belongs to a payload that will not be.
+  for (const StagingBlock& block : m_taken_blocks)
+    m_staging.Offer(block);
+
+  m_taken_blocks.clear();
+
+  DecodedResponse response;
+  response.kind = DecodedResponse::Kind::InvalidResponse;
+  response.reason = std::string(reason);
+
+  Publish(std::move(response));
+}
+
+void
+ResponseDecoder::OnBufferOverflow(size_t buffer_max)
+{
+  DecodedResponse response;
+  response.kind = DecodedResponse::Kind::BufferOverflow;
+  response.buffer_max = buffer_max;
+
+  Publish(std::move(response));
+}
+
+void
+ResponseDecoder::OnRGBBuffer(const unsigned char* rgb,
+                             size_t width,
+                             size_t height,
+                             size_t request_id)
+{
+  if (std::optional<StagingBlock> block = TakeStagingBlock(rgb)) {
+
+    // The frame may have been replaced while the payload was written.
+    if (IsStale(request_id)) {
+      m_staging.Offer(*block);
+      return;
+    }
+
+    std::unique_ptr<PartitionBuffer> partition(new PartitionBuffer());
+
+    partition->request_id = request_id;
+    partition->width = width;
+    partition->height = height;
+    partition->has_alpha = false;
+    partition->staging = block;
+
+    DecodedResponse response;
+    response.partition = std::move(partition);
+
+    Publish(std::move(response));
+
+    return;
+  }
+
+  std::unique_ptr<PartitionBuffer> partition =
+    MakePartition(width, height, request_id);
+
+  ConvertRGBToRGBA(rgb, partition->pixels.data(), width * height);
+
+  DecodedResponse response;
+  response.partition = std::move(partition);
+
+  Publish(std::move(response));
+}
+
+void
+ResponseDecoder::OnRGBRows(const RGBRowRange& rows)
+{
+  // The frame may have been replaced while the rows were streaming in. The
+  // consumer drops the rows that were already passed on.
+  if (IsStale(rows.request_id))
+    return;
+
+  // The rows are passed on as they are, so that only the rows of one write
+  // are held at a time, instead of the whole partition.
+  std::unique_ptr<PartitionBuffer> partition(new PartitionBuffer());
+
+  partition->request_id = rows.request_id;
+  partition->width = rows.width;
+  partition->height = rows.height;
+  partition->first_row = rows.first_row;
+  partition->has_alpha = false;
+  partition->pixels.assign(rows.data,
+                           rows.data + (rows.row_count * rows.width * 3));
+
+  DecodedResponse response;
+  response.kind = DecodedResponse::Kind::Rows;
+  response.partition = std::move(partition);
+
+  Publish(std::move(response));
+}
+
+auto
+ResponseDecoder::GetPayloadDestination(size_t width,
+                                       size_t height,
+                                       size_t request_id) -> unsigned char*
+{
+  (void)request_id;
+
+  const size_t size = width * height * 3;
+
+  if (!size)
+    return nullptr;
+
+  // Without a block to spare, the payload is decoded the usual way instead of
+  // waiting for one.
+  const std::optional<StagingBlock> block = m_staging.Take(size);
+  if (!block)
+    return nullptr;
+
+  m_taken_blocks.emplace_back(*block);
+
+  return block->data;
+}
+
+auto
+ResponseDecoder::TakeStagingBlock(const unsigned char* data)
+  -> std::optional<StagingBlock>
+{
+  for (size_t i = 0; i < m_taken_blocks.size(); i++) {
+
+    if (m_taken_blocks[i].data != data)
+      continue;
+
+    const StagingBlock block = m_taken_blocks[i];
+
+    m_taken_blocks.erase(m_taken_blocks.begin() + i);
+
+    return block;
+  }
+
+  return std::nullopt;
+}
+
+bool
+ResponseDecoder::IsStale(size_t request_id) const
+{
+  return request_id < m_first_current_request.load(std::memory_order_relaxed);
+}
+
+void
+ResponseDecoder::Publish(DecodedResponse&& response)
+{
+  const size_t pixel_bytes = GetPixelBytes(response);
+
+  bool notified = false;
+
+  while (!TryPush(response, pixel_bytes)) {
+
+    if (m_stopped.load())
+      return;
+
+    if (!notified && m_notify) {
+      // The consumer may be waiting for a notification before it makes room
+      // in the queue.
+      m_notify();
+      notified = true;
+    }
+
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+
+  m_publish_count++;
+}
+
+bool
+ResponseDecoder::TryPush(DecodedResponse& response, size_t pixel_bytes)
+{
+  const size_t queued = m_queued_bytes.load(std::memory_order_acquire);
+
+  // A response larger than the budget still gets through once nothing else is
+  // queued.
+  if (queued && ((queued + pixel_bytes) > m_max_queued_bytes))
+    return false;
+
+  // The bytes are counted before the response can be taken, so that the count
+  // never drops below zero.
+  m_queued_bytes.fetch_add(pixel_bytes, std::memory_order_release);
+
+  if (m_queue.TryPush(std::move(response)))
+    return true;
+
+  m_queued_bytes.fetch_sub(pixel_bytes, std::memory_order_release);
+
+  return false;
+}
+
+} // namespace vision::gui
@@ -0,0 +1,193 @@
+#pragma once
+
+#include "response.hpp"
+#include "spsc_queue.hpp"
+#include "staging_pool.hpp"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <stddef.h>
+
+namespace vision::gui {
+
+/// A decoded partition, or some of its rows. Once it is handed to the
+/// consumer, it is no longer modified.
+struct PartitionBuffer final
+{
+  size_t request_id = 0;
+
+  size_t width = 0;
+
+  /// The height of the whole partition.
+  size_t height = 0;
+
+  /// The index of the first row in the pixels.
+  size_t first_row = 0;
+
+  /// Whether the pixels have four bytes each (RGBA) instead of three (RGB).
+  bool has_alpha = true;
+
+  std::vector<unsigned char> pixels;
+
+  /// The staging block that the pixels were decoded into, in which case they
+  /// are not in @ref pixels. The block goes back to its owner with the
+  /// partition.
+  std::optional<StagingBlock> staging;
+
+  /// @return The pixels, wherever they were decoded.
+  const unsigned char* GetData() const noexcept
+  {
+    return staging ? staging->data : pixels.data();
+  }
+
+  /// @return The number of bytes in the pixels.
+  size_t GetSize() const noexcept
+  {
+    return staging ? (width * height * 3) : pixels.size();
+  }
+
+  /// @return The number of rows in the pixels.
+  size_t GetRowCount() const noexcept
+  {
+    const size_t row_size = width * (has_alpha ? 4 : 3);
+
+    return row_size ? (GetSize() / row_size) : 0;
+  }
+};
+
+/// An item produced by the decoder, which is either a complete partition, the
+/// rows of a partition that is received incrementally, or an error found in
+/// the responses.
+struct DecodedResponse final
+{
+  enum class Kind
+  {
+    Partition,
+    /// Rows of a partition, which are passed on as they arrive so that large
+    /// partitions are never held as a whole. The rows of a partition come in
+    /// order, without the rows of other partitions in between.
+    Rows,
+    InvalidResponse,
+    BufferOverflow
+  };
+
+  Kind kind = Kind::Partition;
+
+  std::unique_ptr<const PartitionBuffer> partition;
+
+  std::string reason;
+
+  size_t buffer_max = 0;
+};
+
+/// Parses the responses of a connection and decodes the RGB buffers into
+/// partition buffers, which can be passed on to another thread. Payloads are
+/// decoded straight into the blocks of the staging pool while there are any
+/// to spare. The data is
+/// written by one thread (the producer) and the decoded responses are taken
+/// by another thread (the consumer).
+class ResponseDecoder final : private ResponseObserver
+{
+public:
+  /// @param notify Called by the producer after a write that decoded at least
+  ///               one response.
+  ///
+  /// @param queue_capacity The number of decoded responses that can be
+  ///                       waiting for the consumer. When this is reached,
+  ///                       the producer waits for the consumer.
+  ///
+  /// @param max_queued_bytes The number of pixel bytes that can be waiting
+  ///                         for the consumer. When this would be exceeded,
+  ///                         the producer waits for the consumer. A single
+  ///                         response is always let through.
+  ResponseDecoder(std::function<void()> notify,
+                  size_t queue_capacity = 256,
+                  size_t max_queued_bytes = default_max_queued_bytes);
+
+  static constexpr size_t default_max_queued_bytes = 64 * 1024 * 1024;
+
+  /// Can only be called by the producer.
+  void Write(const char* data, size_t length);
+
+  /// Can only be called by the consumer.
+  bool TryPop(DecodedResponse& response);
+
+  /// Stops the producer from waiting on a full queue. Any response decoded
+  /// after this is dropped. Can be called from any thread.
+  void Stop() noexcept;
+
+  /// Marks the replies to every request with an ID below the given one as
+  /// stale, so that their payloads are skipped instead of decoded. Can be
+  /// called from any thread.
+  void SetFirstCurrentRequest(size_t request_id) noexcept;
+
+  /// Can only be called by the producer.
+  auto GetParser() -> ResponseParser& { return *m_parser; }
+
+  /// The staging memory that payloads can be decoded into. Blocks are offered
+  /// by the consumer. Can be called from any thread.
+  auto GetStagingPool() -> StagingPool& { return m_staging; }
+
+private:
+  void OnInvalidResponse(const std::string_view& reason) override;
+
+  void OnBufferOverflow(size_t buffer_max) override;
+
+  void OnRGBBuffer(const unsigned char* rgb,
+                   size_t width,
+                   size_t height,
+                   size_t request_id) override;
+
+  bool SupportsRows() const override { return true; }
+
+  auto GetPayloadDestination(size_t width,
+                             size_t height,
+                             size_t request_id) -> unsigned char* override;
+
+  void OnRGBRows(const RGBRowRange& rows) override;
+
+  bool IsStale(size_t request_id) const override;
+
+  void Publish(DecodedResponse&& response);
+
+  /// Queues a response if there is room for it and its pixels.
+  bool TryPush(DecodedResponse& response, size_t pixel_bytes);
+
+  /// Takes back the staging block that a payload was decoded into.
+  ///
+  /// @return A null optional if the payload was not decoded into a block.
+  auto TakeStagingBlock(const unsigned char* data)
+    -> std::optional<StagingBlock>;
+
+private:
+  std::function<void()> m_notify;
+
+  SpscQueue<DecodedResponse> m_queue;
+
+  std::unique_ptr<ResponseParser> m_parser;
+
+  /// The number of responses published by the current write.
+  size_t m_publish_count = 0;
+
+  std::atomic<bool> m_stopped{ false };
+
+  /// The number of pixel bytes published and not yet taken by the consumer.
+  std::atomic<size_t> m_queued_bytes{ 0 };
+
+  size_t m_max_queued_bytes;
+
+  std::atomic<size_t> m_first_current_request{ 0 };
+
+  StagingPool m_staging;
+
+  /// The staging blocks taken for payloads that are not passed on yet. Only
+  /// accessed by the producer.
+  std::vector<StagingBlock> m_taken_blocks;
+};
+
+} // namespace vision::gui
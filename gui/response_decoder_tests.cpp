@@ -0,0 +1,271 @@
+#include <gtest/gtest.h>
+
+#include "response_decoder.hpp"
+
+#include <string>
+#include <thread>
+
+using namespace vision::gui;
+
+namespace {
+
+void
+Write(ResponseDecoder& decoder, const std::string& str)
+{
+  decoder.Write(str.data(), str.size());
+}
+
+} // namespace
+
+TEST(ResponseDecoder, Partition)
+{
+  size_t notify_count = 0;
+
+  ResponseDecoder decoder([&notify_count] { notify_count++; });
+
+  Write(decoder, "rgb buffer 2 1 3\n\x01\x02\x03\x04\x05\x06");
+
+  EXPECT_EQ(notify_count, 1);
+
+  DecodedResponse response;
+
+  ASSERT_TRUE(decoder.TryPop(response));
+
+  EXPECT_EQ(response.kind, DecodedResponse::Kind::Partition);
+
+  ASSERT_NE(response.partition, nullptr);
+
+  EXPECT_EQ(response.partition->request_id, 3);
+  EXPECT_EQ(response.partition->width, 2);
+  EXPECT_EQ(response.partition->height, 1);
+
+  const std::vector<unsigned char> expected{ 1, 2, 3, 255, 4, 5, 6, 255 };
+
+  EXPECT_EQ(response.partition->pixels, expected);
+
+  EXPECT_FALSE(decoder.TryPop(response));
+}
+
+TEST(ResponseDecoder, RowsAsTheyArrive)
+{
+  size_t notify_count = 0;
+
+  ResponseDecoder decoder([&notify_count] { notify_count++; });
+
+  Write(decoder, "rgb buffer 1 2 0\n\x01\x02");
+
+  EXPECT_EQ(notify_count, 0);
+
+  Write(decoder, "\x03\x04");
+
+  EXPECT_EQ(notify_count, 1);
+
+  DecodedResponse response;
+
+  ASSERT_TRUE(decoder.TryPop(response));
+
+  EXPECT_EQ(response.kind, DecodedResponse::Kind::Rows);
+
+  ASSERT_NE(response.partition, nullptr);
+
+  EXPECT_EQ(response.partition->request_id, 0);
+  EXPECT_EQ(response.partition->height, 2);
+  EXPECT_EQ(response.partition->first_row, 0);
+  EXPECT_EQ(response.partition->GetRowCount(), 1);
+  EXPECT_FALSE(response.partition->has_alpha);
+
+  EXPECT_EQ(response.partition->pixels,
+            (std::vector<unsigned char>{ 1, 2, 3 }));
+
+  EXPECT_FALSE(decoder.TryPop(response));
+
+  Write(decoder, "\x05\x06");
+
+  EXPECT_EQ(notify_count, 2);
+
+  ASSERT_TRUE(decoder.TryPop(response));
+
+  EXPECT_EQ(response.kind, DecodedResponse::Kind::Rows);
+
+  EXPECT_EQ(response.partition->first_row, 1);
+
+  EXPECT_EQ(response.partition->pixels,
+            (std::vector<unsigned char>{ 4, 5, 6 }));
+}
+
+TEST(ResponseDecoder, SkipsStaleReplies)
+{
+  ResponseDecoder decoder(nullptr);
+
+  // The frame is replaced while the rows of request 0 are streaming in.
+  Write(decoder, "rgb buffer 1 2 0\n\x01\x02\x03");
+
+  decoder.SetFirstCurrentRequest(1);
+
+  Write(decoder, "\x04\x05\x06rgb buffer 1 1 0\n\x07\x08\x09");
+
+  Write(decoder, "rgb buffer 1 1 1\n\x0a\x0b\x0c");
+
+  DecodedResponse response;
+
+  // The first row was passed on before the frame was replaced.
+  ASSERT_TRUE(decoder.TryPop(response));
+
+  EXPECT_EQ(response.kind, DecodedResponse::Kind::Rows);
+
+  EXPECT_EQ(response.partition->request_id, 0);
+
+  ASSERT_TRUE(decoder.TryPop(response));
+
+  EXPECT_EQ(response.kind, DecodedResponse::Kind::Partition);
+
+  ASSERT_NE(response.partition, nullptr);
+
+  EXPECT_EQ(response.partition->request_id, 1);
+
+  EXPECT_FALSE(decoder.TryPop(response));
+}
+
+TEST(ResponseDecoder, InvalidResponse)
+{
+  ResponseDecoder decoder(nullptr);
+
+  Write(decoder, "bad input\n");
+
+  DecodedResponse response;
+
+  ASSERT_TRUE(decoder.TryPop(response));
+
+  EXPECT_EQ(response.kind, DecodedResponse::Kind::InvalidResponse);
+
+  EXPECT_EQ(response.reason, "Header line is not recognizable.");
+}
+
+TEST(ResponseDecoder, WaitsForConsumer)
+{
+  ResponseDecoder decoder(nullptr, 1);
+
+  std::string input;
+
+  for (size_t i = 0; i < 8; i++)
+    input += "rgb buffer 1 1 " + std::to_string(i) + "\nxyz";
+
+  std::thread producer([&decoder, &input] { Write(decoder, input); });
+
+  size_t expected_id = 0;
+
+  while (expected_id < 8) {
+
+    DecodedResponse response;
+
+    if (!decoder.TryPop(response)) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    ASSERT_NE(response.partition, nullptr);
+
+    EXPECT_EQ(response.partition->request_id, expected_id);
+
+    expected_id++;
+  }
+
+  producer.join();
+}
+
+TEST(ResponseDecoder, WaitsForConsumerBytes)
+{
+  // Room for the pixels of two responses of one pixel each.
+  ResponseDecoder decoder(nullptr, 256, 8);
+
+  std::string input;
+
+  for (size_t i = 0; i < 8; i++)
+    input += "rgb buffer 1 1 " + std::to_string(i) + "\nxyz";
+
+  // Larger than the budget, which still gets through on its own.
+  input += "rgb buffer 4 1 8\n" + std::string(12, 'x');
+
+  std::thread producer([&decoder, &input] { Write(decoder, input); });
+
+  size_t expected_id = 0;
+
+  while (expected_id < 9) {
+
+    DecodedResponse response;
+
+    if (!decoder.TryPop(response)) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    ASSERT_NE(response.partition, nullptr);
+
+    EXPECT_EQ(response.partition->request_id, expected_id);
+
+    expected_id++;
+  }
+
+  producer.join();
+}
+
+TEST(ResponseDecoder, DecodesIntoStagingBlocks)
+{
+  ResponseDecoder decoder(nullptr);
+
+  std::vector<unsigned char> memory(6);
+
+  decoder.GetStagingPool().Offer(StagingBlock{ 4, memory.data(), 6 });
+
+  Write(decoder, "rgb buffer 2 1 3\n\x01\x02\x03\x04\x05\x06");
+
+  // There is no block left for this one.
+  Write(decoder, "rgb buffer 1 1 4\n\x07\x08\x09");
+
+  DecodedResponse response;
+
+  ASSERT_TRUE(decoder.TryPop(response));
+
+  ASSERT_NE(response.partition, nullptr);
+
+  const PartitionBuffer& staged = *response.partition;
+
+  ASSERT_TRUE(staged.staging);
+  EXPECT_EQ(staged.staging->index, 4);
+  EXPECT_EQ(staged.GetData(), memory.data());
+  EXPECT_EQ(staged.GetSize(), 6);
+  EXPECT_FALSE(staged.has_alpha);
+  EXPECT_TRUE(staged.pixels.empty());
+
+  EXPECT_EQ(memory, (std::vector<unsigned char>{ 1, 2, 3, 4, 5, 6 }));
+
+  ASSERT_TRUE(decoder.TryPop(response));
+
+  ASSERT_NE(response.partition, nullptr);
+
+  EXPECT_FALSE(response.partition->staging);
+  EXPECT_EQ(response.partition->request_id, 4);
+}
+
+TEST(ResponseDecoder, OffersStaleStagingBlocksAgain)
+{
+  ResponseDecoder decoder(nullptr);
+
+  std::vector<unsigned char> memory(6);
+
+  decoder.GetStagingPool().Offer(StagingBlock{ 0, memory.data(), 6 });
+
+  Write(decoder, "rgb buffer 2 1 0\n\x01\x02\x03");
+
+  EXPECT_EQ(decoder.GetStagingPool().GetAvailableCount(), 0);
+
+  decoder.SetFirstCurrentRequest(1);
+
+  Write(decoder, "\x04\x05\x06");
+
+  EXPECT_EQ(decoder.GetStagingPool().GetAvailableCount(), 1);
+
+  DecodedResponse response;
+
+  EXPECT_FALSE(decoder.TryPop(response));
+}
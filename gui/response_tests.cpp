@@ -1,8 +1,10 @@
 #include <gtest/gtest.h>
 
+#include "frame_header.hpp"
 #include "response.hpp"
 
 #include <sstream>
+#include <vector>
 
 using namespace vision::gui;
 
@@ -33,6 +35,57 @@ private:
   std::ostream& m_output;
 };
 
+class BatchLogger final : public ResponseObserver
+{
+public:
+  void OnInvalidResponse(const std::string_view&) override {}
+
+  void OnBufferOverflow(size_t) override {}
+
+  void OnRGBBuffer(const unsigned char*, size_t, size_t, size_t) override {}
+
+  void OnRGBBuffers(const RGBPayload*, size_t count) override
+  {
+    m_batch_sizes.emplace_back(count);
+  }
+
+  const std::vector<size_t>& GetBatchSizes() const { return m_batch_sizes; }
+
+private:
+  std::vector<size_t> m_batch_sizes;
+};
+
+class RowLogger final : public ResponseObserver
+{
+public:
+  RowLogger(std::ostream& output)
+    : m_output(output)
+  {}
+
+  void OnInvalidResponse(const std::string_view& reason) override
+  {
+    m_output << "InvalidResponse: " << reason << '\n';
+  }
+
+  void OnBufferOverflow(size_t) override { m_output << "BufferOverflow\n"; }
+
+  void OnRGBBuffer(const unsigned char*, size_t w, size_t h, size_t id) override
+  {
+    m_output << "RGBBuffer " << w << ' ' << h << ' ' << id << '\n';
+  }
+
+  bool SupportsRows() const override { return true; }
+
+  void OnRGBRows(const RGBRowRange& rows) override
+  {
+    m_output << "RGBRows " << rows.request_id << ' ' << rows.first_row << ' '
+             << rows.row_count << '\n';
+  }
+
+private:
+  std::ostream& m_output;
+};
+
 void
 Write(ResponseParser& parser, const std::string& str)
 {
@@ -84,6 +137,169 @@ TEST(Response, RGBBuffer)
   EXPECT_EQ(out, "RGBBuffer 2 3 0\n");
 }
 
+TEST(Response, RGBBuffer_SplitAcrossWrites)
+{
+  std::ostringstream stream;
+
+  ResponseLogger logger(stream);
+
+  std::unique_ptr<ResponseParser> parser = ResponseParser::Create(logger);
+
+  const std::string input = BINARY_STRING("rgb buffer 1 2 7\n"
+                                          "\x00\x11\x00"
+                                          "\x22\x00\x33");
+
+  Write(*parser, input.substr(0, 5));
+
+  Write(*parser, input.substr(5, 14));
+
+  EXPECT_EQ(stream.str(), "");
+
+  Write(*parser, input.substr(19));
+
+  EXPECT_EQ(stream.str(), "RGBBuffer 1 2 7\n");
+
+  const ResponseParserStatistics stats = parser->GetStatistics();
+
+  EXPECT_EQ(stats.bytes_received, input.size());
+
+  EXPECT_EQ(stats.payload_bytes, 6);
+}
+
+TEST(Response, RGBBuffer_ParsedInPlace)
+{
+  std::ostringstream stream;
+
+  ResponseLogger logger(stream);
+
+  std::unique_ptr<ResponseParser> parser = ResponseParser::Create(logger);
+
+  const std::string input = BINARY_STRING("rgb buffer 1 1 0\n"
+                                          "\x00\x11\x00");
+
+  // Leaves out the null terminator, so that nothing is left over.
+  Write(*parser, input.substr(0, input.size() - 1));
+
+  EXPECT_EQ(stream.str(), "RGBBuffer 1 1 0\n");
+
+  EXPECT_EQ(parser->GetStatistics().bytes_copied, 0);
+}
+
+TEST(Response, RGBBuffer_MultiplePerWrite)
+{
+  std::string out = ParseAndLog(BINARY_STRING("rgb buffer 1 1 0\n"
+                                              "\x00\x11\x00"
+                                              "rgb buffer 1 1 1\n"
+                                              "\x22\x00\x33"
+                                              "rgb buffer 1 1 2\n"
+                                              "\x44\x00\x55"));
+
+  EXPECT_EQ(out,
+            "RGBBuffer 1 1 0\n"
+            "RGBBuffer 1 1 1\n"
+            "RGBBuffer 1 1 2\n");
+}
+
+TEST(Response, RGBBuffer_Batched)
+{
+  BatchLogger logger;
+
+  std::unique_ptr<ResponseParser> parser = ResponseParser::Create(logger);
+
+  const std::string input = BINARY_STRING("rgb buffer 1 1 0\n"
+                                          "\x00\x11\x00"
+                                          "rgb buffer 1 1 1\n"
+                                          "\x22\x00\x33"
+                                          "rgb buffer 1 1 2\n"
+                                          "\x44\x00");
+
+  Write(*parser, input.substr(0, 45));
+
+  Write(*parser, input.substr(45));
+
+  ASSERT_EQ(logger.GetBatchSizes().size(), 2);
+
+  EXPECT_EQ(logger.GetBatchSizes()[0], 2);
+
+  EXPECT_EQ(logger.GetBatchSizes()[1], 1);
+}
+
+TEST(Response, RGBBuffer_ValidBeforeInvalid)
+{
+  std::string out = ParseAndLog(BINARY_STRING("rgb buffer 1 1 0\n"
+                                              "\x00\x11\x00"
+                                              "bad input\n"));
+
+  EXPECT_EQ(out,
+            "RGBBuffer 1 1 0\n"
+            "InvalidResponse: Header line is not recognizable.\n");
+}
+
+TEST(Response, RGBBuffer_Rows)
+{
+  std::ostringstream stream;
+
+  RowLogger logger(stream);
+
+  std::unique_ptr<ResponseParser> parser = ResponseParser::Create(logger);
+
+  Write(*parser, "rgb buffer 2 3 5\n");
+
+  EXPECT_EQ(stream.str(), "");
+
+  Write(*parser, std::string(7, 'x'));
+
+  EXPECT_EQ(stream.str(), "RGBRows 5 0 1\n");
+
+  Write(*parser, std::string(11, 'y') + "rgb buffer 1 1 6\nzzz");
+
+  EXPECT_EQ(stream.str(),
+            "RGBRows 5 0 1\n"
+            "RGBRows 5 1 1\n"
+            "RGBRows 5 2 1\n"
+            "RGBBuffer 1 1 6\n");
+}
+
+TEST(Response, RGBBuffer_RowsKeepBufferBounded)
+{
+  std::ostringstream stream;
+
+  RowLogger logger(stream);
+
+  std::unique_ptr<ResponseParser> parser = ResponseParser::Create(logger);
+
+  parser->SetMaxBufferSize(4096);
+
+  const std::string input =
+    "rgb buffer 1000 1000 1\n" + std::string(1000 * 1000 * 3, 'x');
+
+  for (size_t offset = 0; offset < input.size(); offset += 1000)
+    EXPECT_TRUE(parser->Write(&input[offset], 1000));
+
+  EXPECT_EQ(stream.str().find("BufferOverflow"), std::string::npos);
+
+  EXPECT_EQ(parser->GetStatistics().payload_bytes, 1000 * 1000 * 3);
+}
+
+TEST(Response, RGBBuffer_ExceedsBufferMaxWithoutRows)
+{
+  std::ostringstream stream;
+
+  ResponseLogger logger(stream);
+
+  std::unique_ptr<ResponseParser> parser = ResponseParser::Create(logger);
+
+  parser->SetMaxBufferSize(4096);
+
+  Write(*parser, "rgb buffer 100 100 1\n");
+
+  Write(*parser, std::string(4096, 'x'));
+
+  Write(*parser, std::string(4096, 'x'));
+
+  EXPECT_EQ(stream.str(), "BufferOverflow\n");
+}
+
 TEST(Response, RGBBuffer_NegativeWidth)
 {
   std::string out = ParseAndLog(BINARY_STRING("rgb buffer -4 1 0\n"));
@@ -155,6 +371,460 @@ TEST(Response, RGBBuffer_TrailingTokens)
   EXPECT_EQ(out, "InvalidResponse: Trailing tokens after request ID.\n");
 }
 
+namespace {
+
+std::string
+MakeFrame(const FrameHeader& header, const std::string& payload)
+{
+  unsigned char data[FrameHeader::encoded_size];
+
+  EncodeFrameHeader(header, data);
+
+  return std::string((const char*)data, sizeof(data)) + payload;
+}
+
+FrameHeader
+MakeRGBFrameHeader(uint32_t w, uint32_t h, uint64_t id)
+{
+  FrameHeader header;
+  header.width = w;
+  header.height = h;
+  header.request_id = id;
+  header.payload_size = w * h * 3;
+  return header;
+}
+
+} // namespace
+
+TEST(Response, FrameHeader_RoundTrip)
+{
+  const FrameHeader in = MakeRGBFrameHeader(640, 480, 0x123456789a);
+
+  unsigned char data[FrameHeader::encoded_size];
+
+  EncodeFrameHeader(in, data);
+
+  EXPECT_EQ(std::string((const char*)data, 4), "VSN2");
+
+  const FrameHeader out = DecodeFrameHeader(data);
+
+  EXPECT_EQ(out.magic, FrameHeader::magic_number);
+  EXPECT_EQ(out.type, FrameType::RGBBuffer);
+  EXPECT_EQ(out.pixel_format, PixelFormat::RGB888);
+  EXPECT_EQ(out.width, 640);
+  EXPECT_EQ(out.height, 480);
+  EXPECT_EQ(out.request_id, 0x123456789a);
+  EXPECT_EQ(out.payload_size, 640 * 480 * 3);
+}
+
+TEST(Response, BinaryProtocol)
+{
+  std::string input = "protocol 2\n";
+
+  input += MakeFrame(MakeRGBFrameHeader(2, 1, 4), std::string(6, 'x'));
+
+  input += MakeFrame(MakeRGBFrameHeader(1, 1, 5), std::string(3, 'y'));
+
+  EXPECT_EQ(ParseAndLog(input),
+            "RGBBuffer 2 1 4\n"
+            "RGBBuffer 1 1 5\n");
+}
+
+TEST(Response, BinaryProtocol_SplitAcrossWrites)
+{
+  std::ostringstream stream;
+
+  ResponseLogger logger(stream);
+
+  std::unique_ptr<ResponseParser> parser = ResponseParser::Create(logger);
+
+  std::string input = "protocol 2\n";
+
+  input += MakeFrame(MakeRGBFrameHeader(2, 2, 9), std::string(12, 'x'));
+
+  for (char c : input)
+    Write(*parser, std::string(1, c));
+
+  EXPECT_EQ(stream.str(), "RGBBuffer 2 2 9\n");
+}
+
+TEST(Response, BinaryProtocol_Rows)
+{
+  std::ostringstream stream;
+
+  RowLogger logger(stream);
+
+  std::unique_ptr<ResponseParser> parser = ResponseParser::Create(logger);
+
+  const std::string frame =
+    MakeFrame(MakeRGBFrameHeader(1, 4, 3), std::string(12, 'x'));
+
+  Write(*parser, "protocol 2\n" + frame.substr(0, 20));
+
+  Write(*parser, frame.substr(20, 20));
+
+  Write(*parser, frame.substr(40));
+
+  EXPECT_EQ(stream.str(),
+            "RGBRows 3 0 2\n"
+            "RGBRows 3 2 1\n"
+            "RGBRows 3 3 1\n");
+}
+
+TEST(Response, BinaryProtocol_SkipsUnknownFrameTypes)
+{
+  FrameHeader unknown_header;
+  unknown_header.type = FrameType(0x7fff);
+  unknown_header.payload_size = 5;
+
+  std::string input = "protocol 2\n";
+
+  input += MakeFrame(unknown_header, "hello");
+
+  input += MakeFrame(MakeRGBFrameHeader(1, 1, 5), std::string(3, 'y'));
+
+  EXPECT_EQ(ParseAndLog(input), "RGBBuffer 1 1 5\n");
+}
+
+TEST(Response, BinaryProtocol_InvalidMagicNumber)
+{
+  FrameHeader header = MakeRGBFrameHeader(1, 1, 0);
+  header.magic = 0;
+
+  const std::string input = "protocol 2\n" + MakeFrame(header, "abc");
+
+  EXPECT_EQ(ParseAndLog(input),
+            "InvalidResponse: Frame header has an invalid magic number.\n");
+}
+
+TEST(Response, BinaryProtocol_PayloadSizeMismatch)
+{
+  FrameHeader header = MakeRGBFrameHeader(1, 1, 0);
+  header.payload_size = 4;
+
+  const std::string input = "protocol 2\n" + MakeFrame(header, "abcd");
+
+  EXPECT_EQ(ParseAndLog(input),
+            "InvalidResponse: Payload size does not match the frame size.\n");
+}
+
+namespace {
+
+/// Serves shared payloads from a string and records what is released.
+class FakeSharedPayloads final : public SharedPayloadSource
+{
+public:
+  FakeSharedPayloads(const std::string& memory)
+    : m_memory(memory)
+  {}
+
+  auto GetPayload(uint64_t position, size_t size)
+    -> const unsigned char* override
+  {
+    if ((position + size) > m_memory.size())
+      return nullptr;
+
+    return (const unsigned char*)(m_memory.data() + position);
+  }
+
+  void Release(uint64_t end_position) override
+  {
+    m_released.emplace_back(end_position);
+  }
+
+  const std::vector<uint64_t>& GetReleased() const { return m_released; }
+
+private:
+  std::string m_memory;
+
+  std::vector<uint64_t> m_released;
+};
+
+std::string
+MakeSharedFrame(uint32_t w, uint32_t h, uint64_t id, uint64_t position)
+{
+  FrameHeader header = MakeRGBFrameHeader(w, h, id);
+  header.type = FrameType::SharedRGBBuffer;
+  header.payload_size = shared_payload_location_size;
+
+  unsigned char location[shared_payload_location_size];
+
+  detail::EncodeLittleEndian(position, location);
+
+  return MakeFrame(header, std::string((const char*)location, 8));
+}
+
+} // namespace
+
+TEST(Response, BinaryProtocol_SharedFrames)
+{
+  std::ostringstream stream;
+
+  ResponseLogger logger(stream);
+
+  std::unique_ptr<ResponseParser> parser = ResponseParser::Create(logger);
+
+  FakeSharedPayloads payloads(std::string(64, 'x'));
+
+  parser->SetSharedPayloadSource(&payloads);
+
+  Write(*parser,
+        "protocol 2\n" + MakeSharedFrame(2, 1, 4, 0) +
+          MakeSharedFrame(1, 2, 5, 6));
+
+  EXPECT_EQ(stream.str(),
+            "RGBBuffer 2 1 4\n"
+            "RGBBuffer 1 2 5\n");
+
+  // Both frames are passed in one batch, so the memory is released once.
+  EXPECT_EQ(payloads.GetReleased(), std::vector<uint64_t>{ 12 });
+
+  EXPECT_EQ(parser->GetStatistics().payload_bytes, size_t(12));
+}
+
+TEST(Response, BinaryProtocol_SharedFrameOutOfRange)
+{
+  std::ostringstream stream;
+
+  ResponseLogger logger(stream);
+
+  std::unique_ptr<ResponseParser> parser = ResponseParser::Create(logger);
+
+  FakeSharedPayloads payloads(std::string(8, 'x'));
+
+  parser->SetSharedPayloadSource(&payloads);
+
+  Write(*parser, "protocol 2\n" + MakeSharedFrame(2, 1, 4, 4));
+
+  EXPECT_EQ(stream.str(), "InvalidResponse: Shared frame is out of range.\n");
+}
+
+TEST(Response, BinaryProtocol_SharedFrameWithoutSource)
+{
+  const std::string input = "protocol 2\n" + MakeSharedFrame(1, 1, 0, 0);
+
+  EXPECT_EQ(ParseAndLog(input),
+            "InvalidResponse: Shared frame received without shared memory.\n");
+}
+
+namespace {
+
+/// Logs responses, treating every request below an ID as stale.
+class StaleLogger final : public ResponseObserver
+{
+public:
+  StaleLogger(std::ostream& output, size_t first_current_id)
+    : m_output(output)
+    , m_first_current_id(first_current_id)
+  {}
+
+  void OnInvalidResponse(const std::string_view& reason) override
+  {
+    m_output << "InvalidResponse: " << reason << '\n';
+  }
+
+  void OnBufferOverflow(size_t) override { m_output << "BufferOverflow\n"; }
+
+  void OnRGBBuffer(const unsigned char*, size_t w, size_t h, size_t id) override
+  {
+    m_output << "RGBBuffer " << w << ' ' << h << ' ' << id << '\n';
+  }
+
+  bool SupportsRows() const override { return true; }
+
+  void OnRGBRows(const RGBRowRange& rows) override
+  {
+    m_output << "RGBRows " << rows.request_id << ' ' << rows.first_row << ' '
+             << rows.row_count << '\n';
+  }
+
+  bool IsStale(size_t request_id) const override
+  {
+    return request_id < m_first_current_id;
+  }
+
+private:
+  std::ostream& m_output;
+
+  size_t m_first_current_id;
+};
+
+} // namespace
+
+TEST(Response, StaleRepliesAreSkipped)
+{
+  std::ostringstream stream;
+
+  StaleLogger logger(stream, 5);
+
+  std::unique_ptr<ResponseParser> parser = ResponseParser::Create(logger);
+
+  const std::string input = "rgb buffer 2 2 4\n" + std::string(12, 'x') +
+                            "rgb buffer 1 1 5\n" + std::string(3, 'y');
+
+  // Split in the middle of the stale payload, which would otherwise be
+  // streamed row by row.
+  Write(*parser, input.substr(0, 20));
+
+  Write(*parser, input.substr(20));
+
+  EXPECT_EQ(stream.str(), "RGBBuffer 1 1 5\n");
+
+  const ResponseParserStatistics stats = parser->GetStatistics();
+
+  EXPECT_EQ(stats.skipped_bytes, size_t(12));
+
+  EXPECT_EQ(stats.payload_bytes, size_t(3));
+
+  // Only the partial header line of the last reply had to be buffered.
+  EXPECT_LE(stats.bytes_copied, size_t(17));
+}
+
+TEST(Response, BinaryProtocol_StaleRepliesAreSkipped)
+{
+  std::ostringstream stream;
+
+  StaleLogger logger(stream, 5);
+
+  std::unique_ptr<ResponseParser> parser = ResponseParser::Create(logger);
+
+  const std::string input =
+    "protocol 2\n" +
+    MakeFrame(MakeRGBFrameHeader(2, 2, 4), std::string(12, 'x')) +
+    MakeFrame(MakeRGBFrameHeader(1, 1, 5), std::string(3, 'y'));
+
+  for (char c : input)
+    Write(*parser, std::string(1, c));
+
+  EXPECT_EQ(stream.str(), "RGBRows 5 0 1\n");
+
+  EXPECT_EQ(parser->GetStatistics().skipped_bytes, size_t(12));
+}
+
+namespace {
+
+/// Logs responses, with the payloads written to destinations it owns.
+class DirectLogger final : public ResponseObserver
+{
+public:
+  DirectLogger(std::ostream& output)
+    : m_output(output)
+  {}
+
+  void OnInvalidResponse(const std::string_view& reason) override
+  {
+    m_output << "InvalidResponse: " << reason << '\n';
+  }
+
+  void OnBufferOverflow(size_t) override { m_output << "BufferOverflow\n"; }
+
+  void OnRGBBuffer(const unsigned char* rgb,
+                   size_t w,
+                   size_t h,
+                   size_t id) override
+  {
+    bool is_destination = false;
+
+    for (const std::vector<unsigned char>& destination : m_destinations)
+      is_destination |= (rgb == destination.data());
+
+    const std::string payload((const char*)rgb, w * h * 3);
+
+    m_output << "RGBBuffer " << w << ' ' << h << ' ' << id << ' ' << payload
+             << (is_destination ? "" : " (not in destination)") << '\n';
+  }
+
+  bool SupportsRows() const override { return true; }
+
+  void OnRGBRows(const RGBRowRange& rows) override
+  {
+    m_output << "RGBRows " << rows.request_id << '\n';
+  }
+
+  auto GetPayloadDestination(size_t w, size_t h, size_t)
+    -> unsigned char* override
+  {
+    m_destinations.emplace_back(w * h * 3);
+
+    return m_destinations.back().data();
+  }
+
+private:
+  std::ostream& m_output;
+
+  std::vector<std::vector<unsigned char>> m_destinations;
+};
+
+} // namespace
+
+TEST(Response, PayloadsWrittenToDestination)
+{
+  std::ostringstream stream;
+
+  DirectLogger logger(stream);
+
+  std::unique_ptr<ResponseParser> parser = ResponseParser::Create(logger);
+
+  const std::string input = "rgb buffer 1 2 4\nabcdef";
+
+  Write(*parser, input.substr(0, 20));
+
+  EXPECT_EQ(stream.str(), "");
+
+  Write(*parser, input.substr(20) + "rgb buffer 1 1 5\nxyz");
+
+  EXPECT_EQ(stream.str(),
+            "RGBBuffer 1 2 4 abcdef\n"
+            "RGBBuffer 1 1 5 xyz\n");
+
+  const ResponseParserStatistics stats = parser->GetStatistics();
+
+  EXPECT_EQ(stats.direct_bytes, size_t(9));
+
+  EXPECT_EQ(stats.payload_bytes, size_t(9));
+
+  EXPECT_EQ(stats.bytes_copied, size_t(0));
+}
+
+TEST(Response, BinaryProtocol_PayloadsWrittenToDestination)
+{
+  std::ostringstream stream;
+
+  DirectLogger logger(stream);
+
+  std::unique_ptr<ResponseParser> parser = ResponseParser::Create(logger);
+
+  const std::string input =
+    "protocol 2\n" + MakeFrame(MakeRGBFrameHeader(2, 1, 7), "abcdef");
+
+  const size_t header_end = input.size() - 6;
+
+  for (size_t i = 0; i < header_end; i++)
+    Write(*parser, input.substr(i, 1));
+
+  const size_t header_bytes_copied = parser->GetStatistics().bytes_copied;
+
+  Write(*parser, input.substr(header_end, 4));
+
+  Write(*parser, input.substr(header_end + 4));
+
+  EXPECT_EQ(stream.str(), "RGBBuffer 2 1 7 abcdef\n");
+
+  const ResponseParserStatistics stats = parser->GetStatistics();
+
+  EXPECT_EQ(stats.direct_bytes, size_t(6));
+
+  // Only the header had to be buffered.
+  EXPECT_EQ(stats.bytes_copied, header_bytes_copied);
+}
+
+TEST(Response, UnsupportedProtocol)
+{
+  std::string out = ParseAndLog(BINARY_STRING("protocol 3\n"));
+
+  EXPECT_EQ(out, "InvalidResponse: Protocol version is not supported.\n");
+}
+
 TEST(Response, UnrecognizedHeader)
 {
   std::string out = ParseAndLog(BINARY_STRING("bad input\n"));
@@ -0,0 +1,160 @@
+#include "response_worker.hpp"
+
+#include <QByteArray>
+
+#ifdef __linux__
+#include "fd_reader.hpp"
+#else
+#include <unistd.h>
+#endif
+
+namespace vision::gui {
+
+#ifdef __linux__
+
+namespace {
+
+class DecoderFeed final : public FdReaderObserver
+{
+public:
+  DecoderFeed(ResponseDecoder& decoder,
+              std::atomic<size_t>& bytes_received,
+              std::function<void()> on_end)
+    : m_decoder(decoder)
+    , m_bytes_received(bytes_received)
+    , m_on_end(std::move(on_end))
+  {}
+
+  void OnRead(const char* data, size_t size) override
+  {
+    m_bytes_received.fetch_add(size, std::memory_order_relaxed);
+
+    m_decoder.Write(data, size);
+  }
+
+  void OnEndOfFile() override { m_on_end(); }
+
+  void OnReadError(int error_number) override
+  {
+    qWarning("Failed to read responses (errno %d).", error_number);
+
+    m_on_end();
+  }
+
+private:
+  ResponseDecoder& m_decoder;
+
+  std::atomic<size_t>& m_bytes_received;
+
+  std::function<void()> m_on_end;
+};
+
+} // namespace
+
+#endif
+
+ResponseWorker::ResponseWorker(QObject* parent)
+  : QObject(parent)
+  , m_decoder([this] { NotifyAvailable(); })
+{
+  m_thread.setObjectName("Response Worker");
+
+  m_context->moveToThread(&m_thread);
+}
+
+ResponseWorker::~ResponseWorker()
+{
+  m_decoder.Stop();
+
+#ifdef __linux__
+  m_fd_reader.reset();
+#endif
+
+  m_thread.quit();
+
+  m_thread.wait();
+
+  delete m_context;
+}
+
+void
+ResponseWorker::Write(const QByteArray& data)
+{
+  if (!m_thread.isRunning())
+    m_thread.start();
+
+  QMetaObject::invokeMethod(
+    m_context,
+    [this, data] {
+      m_bytes_received.fetch_add(data.size(), std::memory_order_relaxed);
+      m_decoder.Write(data.constData(), data.size());
+    },
+    Qt::QueuedConnection);
+}
+
+bool
+ResponseWorker::Read(int fd)
+{
+#ifdef __linux__
+  if (!m_fd_reader_observer) {
+    m_fd_reader_observer.reset(new DecoderFeed(
+      m_decoder, m_bytes_received, [this] { emit EndOfStream(); }));
+  }
+
+  m_fd_reader.reset(new FdReader(*m_fd_reader_observer));
+
+  if (m_fd_reader->Start(fd))
+    return true;
+
+  m_fd_reader.reset();
+
+  return false;
+#else
+  ::close(fd);
+
+  return false;
+#endif
+}
+
+void
+ResponseWorker::SetSharedPayloadSource(
+  std::unique_ptr<SharedPayloadSource> source)
+{
+  m_shared_payloads = std::move(source);
+
+  m_decoder.GetParser().SetSharedPayloadSource(m_shared_payloads.get());
+}
+
+bool
+ResponseWorker::TryPop(DecodedResponse& response)
+{
+  if (m_decoder.TryPop(response))
+    return true;
+
+  m_notify_pending.store(false);
+
+  // Something may have been published after the queue was found empty but
+  // before the flag was cleared, in which case no notification was sent.
+  return m_decoder.TryPop(response);
+}
+
+void
+ResponseWorker::SetFirstCurrentRequest(size_t request_id) noexcept
+{
+  m_decoder.SetFirstCurrentRequest(request_id);
+}
+
+size_t
+ResponseWorker::TakeBytesReceived() noexcept
+{
+  return m_bytes_received.exchange(0, std::memory_order_relaxed);
+}
+
+void
+ResponseWorker::NotifyAvailable()
+{
+  if (!m_notify_pending.exchange(true))
+    emit ResponsesAvailable();
+}
+
+} // namespace vision::gui
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "response_decoder.hpp"
+
+#include <QObject>
+#include <QThread>
+
+#include <atomic>
+#include <memory>
+
+class QByteArray;
+
+namespace vision::gui {
+
+class FdReader;
+class FdReaderObserver;
+
+/// Parses and decodes the responses of a connection on a worker thread. Data
+/// is passed to the worker as it is read, and the decoded partitions are
+/// handed back through a lock-free queue, so that the thread that owns the
+/// worker only has to upload them.
+class ResponseWorker final : public QObject
+{
+  Q_OBJECT
+public:
+  ResponseWorker(QObject* parent);
+
+  ~ResponseWorker();
+
+  /// Passes data to the worker thread to be decoded. The data is implicitly
+  /// shared, so it is not copied.
+  void Write(const QByteArray& data);
+
+  /// Reads the data to decode from a pipe or socket on a dedicated thread,
+  /// which decodes it as it is read instead of going through the event loop
+  /// of the worker thread. The worker takes ownership of the file descriptor.
+  ///
+  /// This should not be combined with @ref Write.
+  ///
+  /// @return False if the file descriptor could not be read this way, which
+  ///         is always the case on platforms other than Linux. The file
+  ///         descriptor is closed in that case.
+  bool Read(int fd);
+
+  /// Sets where the payloads of shared frames are found. This has to be
+  /// called before any data is passed to the worker.
+  void SetSharedPayloadSource(std::unique_ptr<SharedPayloadSource> source);
+
+  /// Takes the next decoded response.
+  ///
+  /// @return False if there are no decoded responses left.
+  bool TryPop(DecodedResponse& response);
+
+  /// Marks the replies to every request with an ID below the given one as
+  /// stale, so that the worker skips them instead of decoding them.
+  void SetFirstCurrentRequest(size_t request_id) noexcept;
+
+  /// The staging memory that the worker decodes payloads into, when it has
+  /// any to spare. Can be called from any thread.
+  auto GetStagingPool() -> StagingPool& { return m_decoder.GetStagingPool(); }
+
+  /// @return The number of bytes received since the last call.
+  size_t TakeBytesReceived() noexcept;
+
+signals:
+  /// Emitted from the worker thread when decoded responses are available. It
+  /// is not emitted again until @ref TryPop has returned false.
+  void ResponsesAvailable();
+
+  /// Emitted from the reader thread when the file descriptor passed to @ref
+  /// Read reaches its end or fails to be read.
+  void EndOfStream();
+
+private:
+  void NotifyAvailable();
+
+private:
+  /// Only started once data is passed with @ref Write.
+  QThread m_thread;
+
+  /// Lives in the worker thread, so that calls can be queued to it.
+  QObject* m_context = new QObject();
+
+  std::atomic<bool> m_notify_pending{ false };
+
+  std::atomic<size_t> m_bytes_received{ 0 };
+
+  /// Declared before the decoder, since the parser refers to it.
+  std::unique_ptr<SharedPayloadSource> m_shared_payloads;
+
+  ResponseDecoder m_decoder;
+
+#ifdef __linux__
+  std::unique_ptr<FdReaderObserver> m_fd_reader_observer;
+
+  std::unique_ptr<FdReader> m_fd_reader;
+#endif
+};
+
+} // namespace vision::gui
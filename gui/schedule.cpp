@@ -1,9 +1,8 @@
 #include "schedule.hpp"
 
 #include "id_generator.hpp"
-#include "vertex.hpp"
 
-#include <set>
+#include <algorithm>
 
 #include <stdint.h>
 
@@ -48,78 +47,179 @@ Log4(size_t n)
   return out;
 }
 
+/// Calls a function with the index of each partition, in the order that they
+/// are rendered. Each level of division adds the partitions in between the
+/// ones of the level before it.
+template<typename Callback>
+void
+ForEachPartition(size_t division_level, Callback callback)
+{
+  const size_t partition_count = size_t(1) << (division_level * 2);
+
+  for (size_t i = 0; i <= division_level; i++) {
+
+    const size_t j_max = size_t(1) << (i * 2);
+
+    const size_t stride = partition_count / j_max;
+
+    for (size_t j = 0; j < j_max; j++) {
+
+      // Every fourth partition was already visited by the level before.
+      if ((i > 0) && ((j % 4) == 0))
+        continue;
+
+      callback(j * stride);
+    }
+  }
+}
+
 } // namespace
 
-Schedule::Schedule(size_t w,
-                   size_t h,
-                   size_t division_level,
-                   IDGenerator& id_generator)
-  : m_width(w)
-  , m_height(h)
-  , m_division_level(division_level)
+auto
+ScheduleLayout::Create(size_t w, size_t h, size_t division_level)
+  -> std::shared_ptr<const ScheduleLayout>
 {
-  const size_t x_pixel_count = GetTextureWidth() / GetDivisionsPerDimension();
-  const size_t y_pixel_count = GetTextureHeight() / GetDivisionsPerDimension();
+  auto layout = std::make_shared<ScheduleLayout>();
 
-  const size_t x_pixel_stride = GetHorizontalStride();
-  const size_t y_pixel_stride = GetVerticalStride();
+  layout->width = w;
+  layout->height = h;
+  layout->division_level = division_level;
 
-  std::set<size_t> indices;
+  const size_t div_count = size_t(1) << division_level;
 
-  const size_t div_count = GetDivisionsPerDimension();
+  const size_t texture_w = ((w + (div_count - 1)) / div_count) * div_count;
+  const size_t texture_h = ((h + (div_count - 1)) / div_count) * div_count;
 
-  for (size_t i = 0; i <= m_division_level; i++) {
+  const size_t x_pixel_count = texture_w / div_count;
+  const size_t y_pixel_count = texture_h / div_count;
 
-    const size_t j_max = (1 << i) * (1 << i);
+  const size_t x_cnt = (div_count > 1) ? x_pixel_count - 1 : x_pixel_count;
+  const size_t y_cnt = (div_count > 1) ? y_pixel_count - 1 : y_pixel_count;
 
-    const size_t stride = (div_count * div_count) / j_max;
+  layout->render_requests.reserve(div_count * div_count);
 
-    for (size_t j = 0; j < j_max; j++) {
+  ForEachPartition(division_level, [&](size_t index) {
+    const RenderRequest req{ 0,
+                             x_cnt,
+                             y_cnt,
+                             ReverseInterleaveX(index),
+                             ReverseInterleaveY(index),
+                             div_count,
+                             div_count,
+                             w,
+                             h };
 
-      const size_t index = j * stride;
+    layout->render_requests.emplace_back(req);
+  });
 
-      const bool exists = (indices.find(index) != indices.end());
-      if (exists)
-        continue;
+  layout->preview_operations.resize(division_level + 1);
 
-      const size_t x_cnt = (div_count > 1) ? x_pixel_count - 1 : x_pixel_count;
-      const size_t y_cnt = (div_count > 1) ? y_pixel_count - 1 : y_pixel_count;
+  for (size_t i = 0; i <= division_level; i++) {
 
-      const RenderRequest req{ id_generator.GenerateID(),
-                               x_cnt,
-                               y_cnt,
-                               ReverseInterleaveX(index),
-                               ReverseInterleaveY(index),
-                               x_pixel_stride,
-                               y_pixel_stride,
-                               m_width,
-                               m_height };
+    const size_t preview_div_count = size_t(1) << i;
 
-      m_render_requests.emplace_back(req);
+    std::vector<PreviewOperation>& operations = layout->preview_operations[i];
 
-      indices.emplace(index);
-    }
+    operations.reserve(preview_div_count * preview_div_count);
+
+    ForEachPartition(i, [&](size_t index) {
+      const PreviewOperation op{ ReverseInterleaveX(index),
+                                 ReverseInterleaveY(index),
+                                 preview_div_count,
+                                 preview_div_count };
+
+      operations.emplace_back(op);
+    });
   }
+
+  return layout;
 }
 
+auto
+ScheduleLayout::CreateTiled(size_t w, size_t h, size_t tile_size)
+  -> std::shared_ptr<const ScheduleLayout>
+{
+  auto layout = std::make_shared<ScheduleLayout>();
+
+  tile_size = std::max(tile_size, size_t(1));
+
+  layout->width = w;
+  layout->height = h;
+  layout->tile_size = tile_size;
+
+  const size_t x_tile_count = (w + (tile_size - 1)) / tile_size;
+  const size_t y_tile_count = (h + (tile_size - 1)) / tile_size;
+
+  layout->render_requests.reserve(x_tile_count * y_tile_count);
+
+  // The Morton order of a square grid, with a power of two size, that covers
+  // all of the tiles. The codes outside of the tiles are skipped.
+  size_t grid_size = 1;
+
+  while ((grid_size < x_tile_count) || (grid_size < y_tile_count))
+    grid_size <<= 1;
+
+  for (size_t code = 0; code < (grid_size * grid_size); code++) {
+
+    const size_t x = ReverseInterleaveX(code);
+    const size_t y = ReverseInterleaveY(code);
+
+    if ((x >= x_tile_count) || (y >= y_tile_count))
+      continue;
+
+    const RenderRequest req{ 0,
+                             tile_size,
+                             tile_size,
+                             x * tile_size,
+                             y * tile_size,
+                             1,
+                             1,
+                             w,
+                             h };
+
+    layout->render_requests.emplace_back(req);
+  }
+
+  // Each tile is drawn as it is, at full resolution.
+  layout->preview_operations.resize(1);
+
+  layout->preview_operations[0].emplace_back(PreviewOperation{ 0, 0, 1, 1 });
+
+  return layout;
+}
+
+Schedule::Schedule(size_t w,
+                   size_t h,
+                   size_t division_level,
+                   IDGenerator& id_generator)
+  : Schedule(ScheduleLayout::Create(w, h, division_level), id_generator)
+{}
+
+Schedule::Schedule(std::shared_ptr<const ScheduleLayout> layout,
+                   IDGenerator& id_generator)
+  : m_layout(std::move(layout))
+  , m_first_id(id_generator.GenerateIDs(m_layout->render_requests.size()))
+  , m_completed(m_layout->render_requests.size())
+{}
+
 size_t
 Schedule::GetRenderRequestCount() const noexcept
 {
-  return m_render_requests.size();
+  return m_layout->render_requests.size();
 }
 
 size_t
 Schedule::GetRemainingRenderRequests() const noexcept
 {
-  if (m_render_request_index > m_render_requests.size())
-    return 0;
-  else
-    return m_render_requests.size() - m_render_request_index;
+  return m_layout->render_requests.size() - m_completed_count;
 }
 
 size_t
 Schedule::GetPartitionCount() const noexcept
 {
+  if (IsTiled())
+    return GetRenderRequestCount();
+
   const size_t divs = GetDivisionsPerDimension();
 
   return divs * divs;
@@ -128,179 +228,327 @@ Schedule::GetPartitionCount() const noexcept
 size_t
 Schedule::GetPartitionWidth() const noexcept
 {
+  if (IsTiled())
+    return m_layout->tile_size;
+
   return GetTextureWidth() / GetDivisionsPerDimension();
 }
 
 size_t
 Schedule::GetPartitionHeight() const noexcept
 {
+  if (IsTiled())
+    return m_layout->tile_size;
+
   return GetTextureHeight() / GetDivisionsPerDimension();
 }
 
 bool
 Schedule::HasPreview() const noexcept
 {
+  // Tiles may complete out of order, so any complete tile is worth drawing.
+  if (IsTiled())
+    return m_completed_count > 0;
+
   return m_render_request_index > 0;
 }
 
 size_t
 Schedule::GetPreviewIndex() const noexcept
 {
+  // Every complete tile is a new preview.
+  if (IsTiled())
+    return m_completed_count - 1;
+
   return Log4(m_render_request_index);
 }
 
-std::vector<PreviewOperation>
-Schedule::GetPreviewOperations() const
+const std::vector<PreviewOperation>&
+Schedule::GetPreviewOperations() const noexcept
 {
-  std::vector<PreviewOperation> operations;
+  static const std::vector<PreviewOperation> no_operations;
 
   if (!HasPreview())
-    return operations;
-
-  const size_t div_count = 1 << GetPreviewIndex();
-
-  std::set<size_t> indices;
+    return no_operations;
 
-  for (size_t i = 0; i < div_count; i++) {
+  if (IsTiled())
+    return m_layout->preview_operations[0];
 
-    const size_t j_max = (1 << i) * (1 << i);
-
-    const size_t stride = (div_count * div_count) / j_max;
-
-    for (size_t j = 0; j < j_max; j++) {
-
-      const size_t index = j * stride;
-
-      const bool exists = (indices.find(index) != indices.end());
-      if (exists)
-        continue;
-
-      const size_t x_pixel_offset = ReverseInterleaveX(index);
-      const size_t y_pixel_offset = ReverseInterleaveY(index);
-
-      const PreviewOperation op{
-        x_pixel_offset, y_pixel_offset, div_count, div_count
-      };
-
-      operations.emplace_back(op);
-
-      indices.emplace(index);
-    }
-  }
-
-  return operations;
+  return m_layout->preview_operations[GetPreviewIndex()];
 }
 
 size_t
 Schedule::GetPreviewCount() const noexcept
 {
-  return m_division_level;
+  if (IsTiled())
+    return GetRenderRequestCount();
+
+  return m_layout->division_level;
 }
 
 size_t
 Schedule::GetTextureWidth() const noexcept
 {
-  const size_t divs = GetDivisionsPerDimension();
+  const size_t divs = IsTiled() ? m_layout->tile_size
+                                : GetDivisionsPerDimension();
 
-  return ((m_width + (divs - 1)) / divs) * divs;
+  return ((m_layout->width + (divs - 1)) / divs) * divs;
 }
 
 size_t
 Schedule::GetTextureHeight() const noexcept
 {
-  const size_t divs = GetDivisionsPerDimension();
+  const size_t divs = IsTiled() ? m_layout->tile_size
+                                : GetDivisionsPerDimension();
 
-  return ((m_height + (divs - 1)) / divs) * divs;
+  return ((m_layout->height + (divs - 1)) / divs) * divs;
 }
 
 size_t
 Schedule::GetVerticalStride() const noexcept
 {
+  if (IsTiled())
+    return 1;
+
   return GetDivisionsPerDimension();
 }
 
 size_t
 Schedule::GetHorizontalStride() const noexcept
 {
+  if (IsTiled())
+    return 1;
+
   // return GetTextureWidth() / GetDivisionsPerDimension();
   return GetDivisionsPerDimension();
 }
 
+size_t
+Schedule::GetPreviewStride() const noexcept
+{
+  if (IsTiled())
+    return 1;
+
+  // Each preview has twice the resolution of the one before it, up to the
+  // stride of the render requests.
+  return GetHorizontalStride() >> GetPreviewIndex();
+}
+
 size_t
 Schedule::GetDivisionsPerDimension() const noexcept
 {
-  return 1 << m_division_level;
+  return size_t(1) << m_layout->division_level;
+}
+
+RenderRequest
+Schedule::GetRenderRequest() const
+{
+  return GetRenderRequest(m_render_request_index);
+}
+
+RenderRequest
+Schedule::GetRenderRequest(size_t index) const
+{
+  if (index >= m_layout->render_requests.size())
+    return RenderRequest();
+
+  RenderRequest req = m_layout->render_requests[index];
+
+  req.id = m_first_id + index;
+
+  return req;
+}
+
+std::optional<size_t>
+Schedule::FindRenderRequest(size_t id) const noexcept
+{
+  // The IDs are generated in the order that the render requests are made.
+  if ((id < m_first_id) || ((id - m_first_id) >= m_completed.size()))
+    return std::nullopt;
+
+  return id - m_first_id;
+}
+
+bool
+Schedule::IsRenderRequestComplete(size_t index) const noexcept
+{
+  return (index < m_completed.size()) && m_completed[index];
 }
 
-std::vector<Vertex>
-Schedule::GetVertexBuffer() const
+bool
+Schedule::CompleteRenderRequest(size_t index)
 {
-  const size_t partition_w = GetPartitionWidth();
-  const size_t partition_h = GetPartitionHeight();
+  if ((index >= m_completed.size()) || m_completed[index])
+    return false;
+
+  m_completed[index] = true;
+
+  m_completed_count++;
+
+  while ((m_render_request_index < m_completed.size()) &&
+         m_completed[m_render_request_index])
+    m_render_request_index++;
+
+  return true;
+}
+
+size_t
+Schedule::CompleteCoveredRequests(const Schedule& other)
+{
+  if ((other.GetFrameWidth() != GetFrameWidth()) ||
+      (other.GetFrameHeight() != GetFrameHeight()))
+    return 0;
+
+  if (IsTiled() || other.IsTiled() || other.m_layout->render_requests.empty())
+    return 0;
+
+  const size_t other_stride = other.GetDivisionsPerDimension();
+
+  // The render requests of the other schedule, by their pixel offset.
+  std::vector<size_t> other_indices(other_stride * other_stride);
+
+  for (size_t i = 0; i < other.m_layout->render_requests.size(); i++) {
+    const RenderRequest& req = other.m_layout->render_requests[i];
+    other_indices[(req.y_pixel_offset * other_stride) + req.x_pixel_offset] = i;
+  }
 
-  const float x_scale = 1.0f / partition_w;
-  const float y_scale = 1.0f / partition_h;
+  auto other_is_complete = [&](size_t x, size_t y) {
+    const size_t index = other_indices[(y * other_stride) + x];
+    return other.IsRenderRequestComplete(index);
+  };
 
-  std::vector<Vertex> vertices(partition_w * partition_h * 6);
+  // Every render request of the other schedule has the same number of pixels.
+  const RenderRequest& other_req = other.m_layout->render_requests[0];
 
-  for (size_t y = 0; y < partition_h; y++) {
+  // Checks that the pixels of a render request, along one axis, are all
+  // within the pixels of the other render requests at the same offsets. The
+  // pixel counts and the padding differ between division levels, so the last
+  // pixels of a render request may be past the last ones of the other.
+  //
+  // @param offsets Set to whether any pixel is at each of the other offsets.
+  auto axis_is_covered = [other_stride](size_t offset,
+                                        size_t stride,
+                                        size_t count,
+                                        size_t other_count,
+                                        std::vector<bool>& offsets) {
+    offsets.assign(other_stride, false);
 
-    for (size_t x = 0; x < partition_w; x++) {
+    for (size_t k = 0; k < count; k++) {
+
+      const size_t pixel = offset + (k * stride);
+
+      const size_t other_offset = pixel % other_stride;
+
+      if (pixel >= (other_offset + (other_count * other_stride)))
+        return false;
+
+      offsets[other_offset] = true;
+    }
 
-      const float x0 = (x + 0) * x_scale;
-      const float y0 = (y + 0) * y_scale;
+    return true;
+  };
 
-      const float x1 = (x + 1) * x_scale;
-      const float y1 = (y + 1) * y_scale;
+  std::vector<bool> x_offsets;
 
-      const float dx0 = 0.0f;
-      const float dy0 = 0.0f;
+  std::vector<bool> y_offsets;
 
-      const float dx1 = x1 - x0;
-      const float dy1 = y1 - y0;
+  const size_t stride = GetDivisionsPerDimension();
 
-      const Vertex p00(x0, y0, dx0, dy0);
-      const Vertex p10(x0, y0, dx1, dy0);
-      const Vertex p01(x0, y0, dx0, dy1);
-      const Vertex p11(x0, y0, dx1, dy1);
+  size_t completed = 0;
 
-      size_t i = ((y * partition_w) + x) * 6;
+  for (size_t i = 0; i < m_layout->render_requests.size(); i++) {
 
-      vertices[i + 0] = p00;
-      vertices[i + 1] = p01;
-      vertices[i + 2] = p10;
+    const RenderRequest& req = m_layout->render_requests[i];
 
-      vertices[i + 3] = p01;
-      vertices[i + 4] = p11;
-      vertices[i + 5] = p10;
+    // A render request without pixels has nothing left to receive.
+    if ((req.x_pixel_count == 0) || (req.y_pixel_count == 0)) {
+      if (CompleteRenderRequest(i))
+        completed++;
+      continue;
     }
+
+    bool covered = axis_is_covered(req.x_pixel_offset,
+                                   stride,
+                                   req.x_pixel_count,
+                                   other_req.x_pixel_count,
+                                   x_offsets) &&
+                   axis_is_covered(req.y_pixel_offset,
+                                   stride,
+                                   req.y_pixel_count,
+                                   other_req.y_pixel_count,
+                                   y_offsets);
+
+    for (size_t y = 0; (y < other_stride) && covered; y++) {
+
+      for (size_t x = 0; (x < other_stride) && covered; x++) {
+
+        if (x_offsets[x] && y_offsets[y])
+          covered = other_is_complete(x, y);
+      }
+    }
+
+    if (covered && CompleteRenderRequest(i))
+      completed++;
   }
 
-  return vertices;
+  return completed;
 }
 
-RenderRequest
-Schedule::GetRenderRequest() const
+void
+Schedule::NextRenderRequest()
 {
-  if (m_render_request_index >= m_render_requests.size())
-    return RenderRequest();
-  else
-    return m_render_requests[m_render_request_index];
+  CompleteRenderRequest(m_render_request_index);
 }
 
-RenderRequest
-Schedule::GetRenderRequest(size_t index) const
+ScheduleCache::ScheduleCache(size_t capacity)
+  : m_layouts(capacity)
+{}
+
+auto
+ScheduleCache::GetLayout(size_t w, size_t h, size_t division_level)
+  -> std::shared_ptr<const ScheduleLayout>
 {
-  if (index >= m_render_requests.size())
-    return RenderRequest();
-  else
-    return m_render_requests[index];
+  const Geometry geometry{ w, h, division_level };
+
+  if (auto* layout = m_layouts.Find(geometry))
+    return *layout;
+
+  return m_layouts.Insert(geometry,
+                          ScheduleLayout::Create(w, h, division_level));
 }
 
-void
-Schedule::NextRenderRequest()
+Schedule
+ScheduleCache::MakeSchedule(size_t w,
+                            size_t h,
+                            size_t division_level,
+                            IDGenerator& id_generator)
+{
+  return Schedule(GetLayout(w, h, division_level), id_generator);
+}
+
+auto
+ScheduleCache::GetTiledLayout(size_t w, size_t h, size_t tile_size)
+  -> std::shared_ptr<const ScheduleLayout>
+{
+  // A tile size of zero would make the key of an interleaved layout.
+  tile_size = std::max(tile_size, size_t(1));
+
+  const Geometry geometry{ w, h, 0, tile_size };
+
+  if (auto* layout = m_layouts.Find(geometry))
+    return *layout;
+
+  return m_layouts.Insert(geometry,
+                          ScheduleLayout::CreateTiled(w, h, tile_size));
+}
+
+Schedule
+ScheduleCache::MakeTiledSchedule(size_t w,
+                                 size_t h,
+                                 size_t tile_size,
+                                 IDGenerator& id_generator)
 {
-  m_render_request_index++;
+  return Schedule(GetTiledLayout(w, h, tile_size), id_generator);
 }
 
 } // namespace vision::gui
@@ -1,13 +1,14 @@
 #pragma once
 
+#include "lru_cache.hpp"
 #include "render_request.hpp"
 
+#include <memory>
+#include <optional>
 #include <vector>
 
 namespace vision::gui {
 
-struct Vertex;
-
 class IDGenerator;
 
 /// Describes how to render the results of a render request for a given preview
@@ -21,10 +22,44 @@ struct PreviewOperation final
   size_t y_pixel_stride = 0;
 };
 
+/// The parts of a schedule that only depend on the size of the frame and the
+/// division level, or the tile size. A layout is computed once and shared by
+/// every schedule with the same geometry.
+struct ScheduleLayout final
+{
+  size_t width = 0;
+
+  size_t height = 0;
+
+  size_t division_level = 0;
+
+  /// The width and height of each tile, or zero if the render requests are
+  /// interleaved instead.
+  size_t tile_size = 0;
+
+  /// The render requests, in the order they are made. Their IDs are left at
+  /// zero, since each schedule has its own.
+  std::vector<RenderRequest> render_requests;
+
+  /// The preview operations of each preview index.
+  std::vector<std::vector<PreviewOperation>> preview_operations;
+
+  static auto Create(size_t w, size_t h, size_t division_level)
+    -> std::shared_ptr<const ScheduleLayout>;
+
+  /// Creates a layout of contiguous, square tiles, in Morton order. The frame
+  /// is padded to a whole number of tiles.
+  static auto CreateTiled(size_t w, size_t h, size_t tile_size)
+    -> std::shared_ptr<const ScheduleLayout>;
+};
+
 /// Used for scheduling the rendering of a frame. Divides the frame into
 /// partitions, each with a different starting offset and stride. While each
 /// partition is received, there are several points in which a preview of the
 /// frame is available. The number of partitions depends on the division level.
+///
+/// Alternatively, the frame is divided into tiles, which are better for the
+/// cache of the renderer. Each complete tile is then a new preview.
 class Schedule final
 {
 public:
@@ -33,6 +68,11 @@ public:
            size_t division_level,
            IDGenerator& id_generator);
 
+  /// Makes a schedule from a layout that was already computed. This only
+  /// generates the IDs of the render requests.
+  Schedule(std::shared_ptr<const ScheduleLayout> layout,
+           IDGenerator& id_generator);
+
   size_t GetRemainingRenderRequests() const noexcept;
 
   size_t GetRenderRequestCount() const noexcept;
@@ -53,37 +93,124 @@ public:
 
   size_t GetTextureHeight() const noexcept;
 
-  size_t GetFrameWidth() const noexcept { return m_width; }
+  size_t GetFrameWidth() const noexcept { return m_layout->width; }
 
-  size_t GetFrameHeight() const noexcept { return m_height; }
+  size_t GetFrameHeight() const noexcept { return m_layout->height; }
 
   size_t GetVerticalStride() const noexcept;
 
   size_t GetHorizontalStride() const noexcept;
 
-  std::vector<PreviewOperation> GetPreviewOperations() const;
+  /// Gets the distance between the pixels of the current preview, each of
+  /// which stands in for the pixels to its bottom right.
+  size_t GetPreviewStride() const noexcept;
+
+  bool IsTiled() const noexcept { return m_layout->tile_size > 0; }
+
+  /// @return The size of the tiles, or zero if the schedule is interleaved.
+  size_t GetTileSize() const noexcept { return m_layout->tile_size; }
 
-  std::vector<Vertex> GetVertexBuffer() const;
+  /// Gets the operations for drawing the current preview. These are empty if
+  /// there is no preview yet.
+  const std::vector<PreviewOperation>& GetPreviewOperations() const noexcept;
 
   RenderRequest GetRenderRequest(size_t index) const;
 
+  /// Gets the first render request that has not been completed yet.
   RenderRequest GetRenderRequest() const;
 
+  /// Finds the index of a render request in this schedule.
+  ///
+  /// @param id The ID of the render request.
+  ///
+  /// @return The index of the render request, if it belongs to this schedule.
+  std::optional<size_t> FindRenderRequest(size_t id) const noexcept;
+
+  bool IsRenderRequestComplete(size_t index) const noexcept;
+
+  /// Marks a render request as complete. Render requests may be completed in
+  /// any order, but a preview only becomes available once all of the render
+  /// requests before it have been completed.
+  ///
+  /// @param index The index of the render request.
+  ///
+  /// @return False if the index is out of range or if the render request was
+  ///         already completed.
+  bool CompleteRenderRequest(size_t index);
+
+  /// Completes the render requests whose pixels have all been received by
+  /// another schedule of the same frame size, which may have a different
+  /// division level. Tiled schedules are not supported.
+  ///
+  /// @return The number of render requests that were completed.
+  size_t CompleteCoveredRequests(const Schedule& other);
+
+  /// Completes the render request returned by @ref GetRenderRequest.
   void NextRenderRequest();
 
 private:
   size_t GetDivisionsPerDimension() const noexcept;
 
 private:
-  std::vector<RenderRequest> m_render_requests;
+  std::shared_ptr<const ScheduleLayout> m_layout;
 
+  /// The ID of the first render request. The IDs of the others follow it.
+  size_t m_first_id = 0;
+
+  /// Which of the render requests have been completed.
+  std::vector<bool> m_completed;
+
+  size_t m_completed_count = 0;
+
+  /// The number of render requests, from the first one, that have all been
+  /// completed.
   size_t m_render_request_index = 0;
+};
+
+/// Keeps the layouts of the most recently used frame geometries, so that a
+/// new frame at one of them only costs new render request IDs.
+class ScheduleCache final
+{
+public:
+  /// @param capacity The number of frame geometries to keep the layouts of.
+  ScheduleCache(size_t capacity = 8);
+
+  auto GetLayout(size_t w, size_t h, size_t division_level)
+    -> std::shared_ptr<const ScheduleLayout>;
+
+  auto GetTiledLayout(size_t w, size_t h, size_t tile_size)
+    -> std::shared_ptr<const ScheduleLayout>;
+
+  Schedule MakeSchedule(size_t w,
+                        size_t h,
+                        size_t division_level,
+                        IDGenerator& id_generator);
+
+  Schedule MakeTiledSchedule(size_t w,
+                             size_t h,
+                             size_t tile_size,
+                             IDGenerator& id_generator);
+
+private:
+  struct Geometry final
+  {
+    size_t width = 0;
+
+    size_t height = 0;
+
+    size_t division_level = 0;
 
-  size_t m_width = 0;
+    size_t tile_size = 0;
 
-  size_t m_height = 0;
+    bool operator==(const Geometry& other) const noexcept
+    {
+      return (width == other.width) && (height == other.height) &&
+             (division_level == other.division_level) &&
+             (tile_size == other.tile_size);
+    }
+  };
 
-  size_t m_division_level = 0;
+  LruCache<Geometry, std::shared_ptr<const ScheduleLayout>> m_layouts;
 };
 
 } // namespace vision::gui
@@ -0,0 +1,128 @@
+#include <benchmark/benchmark.h>
+
+#include "id_generator.hpp"
+#include "schedule.hpp"
+
+#include <atomic>
+#include <new>
+
+#include <stdlib.h>
+
+using namespace vision::gui;
+
+namespace {
+
+/// The number of allocations made through the global operator new.
+std::atomic<size_t> allocation_count{ 0 };
+
+} // namespace
+
+#if defined(__GNUC__) && !defined(__clang__)
+// Once the operators below are inlined, GCC pairs them with the built in ones.
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void*
+operator new(size_t size)
+{
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+
+  if (void* ptr = malloc(size ? size : 1))
+    return ptr;
+
+  throw std::bad_alloc();
+}
+
+void
+operator delete(void* ptr) noexcept
+{
+  free(ptr);
+}
+
+void
+operator delete(void* ptr, size_t) noexcept
+{
+  free(ptr);
+}
+
+namespace {
+
+void
+SetAllocationCounter(benchmark::State& state, size_t allocations)
+{
+  state.counters["allocations_per_iteration"] =
+    benchmark::Counter(double(allocations), benchmark::Counter::kAvgIterations);
+}
+
+/// Makes a new frame of the same geometry on each iteration, like the view
+/// does when the content changes.
+void
+BM_Schedule_NewFrame(benchmark::State& state)
+{
+  const size_t div_level = state.range(0);
+
+  IDGenerator id_generator;
+
+  const size_t allocations = allocation_count.load();
+
+  for (auto _ : state) {
+    Schedule schedule(1920, 1080, div_level, id_generator);
+    benchmark::DoNotOptimize(schedule.GetRenderRequest());
+  }
+
+  SetAllocationCounter(state, allocation_count.load() - allocations);
+}
+
+void
+BM_Schedule_NewFrameCached(benchmark::State& state)
+{
+  const size_t div_level = state.range(0);
+
+  IDGenerator id_generator;
+
+  ScheduleCache cache;
+
+  const size_t allocations = allocation_count.load();
+
+  for (auto _ : state) {
+    Schedule schedule = cache.MakeSchedule(1920, 1080, div_level, id_generator);
+    benchmark::DoNotOptimize(schedule.GetRenderRequest());
+  }
+
+  SetAllocationCounter(state, allocation_count.load() - allocations);
+}
+
+/// Queries the schedule the way that each paint of the view does.
+void
+BM_Schedule_Paint(benchmark::State& state)
+{
+  const size_t div_level = state.range(0);
+
+  IDGenerator id_generator;
+
+  Schedule schedule(1920, 1080, div_level, id_generator);
+
+  for (size_t i = 0; i < (schedule.GetRenderRequestCount() / 2); i++)
+    schedule.NextRenderRequest();
+
+  const size_t allocations = allocation_count.load();
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(schedule.HasPreview());
+    benchmark::DoNotOptimize(schedule.GetTextureWidth());
+    benchmark::DoNotOptimize(schedule.GetTextureHeight());
+    benchmark::DoNotOptimize(schedule.GetHorizontalStride() >>
+                             schedule.GetPreviewIndex());
+    benchmark::DoNotOptimize(schedule.GetPreviewOperations().data());
+  }
+
+  SetAllocationCounter(state, allocation_count.load() - allocations);
+}
+
+BENCHMARK(BM_Schedule_NewFrame)->Arg(0)->Arg(2)->Arg(4);
+
+BENCHMARK(BM_Schedule_NewFrameCached)->Arg(0)->Arg(2)->Arg(4);
+
+BENCHMARK(BM_Schedule_Paint)->Arg(2)->Arg(4);
+
+} // namespace
@@ -4,7 +4,6 @@
 
 #include "id_generator.hpp"
 #include "schedule.hpp"
-#include "vertex.hpp"
 
 using namespace vision::gui;
 
@@ -18,6 +17,14 @@ MakeSchedule(size_t w, size_t h, size_t div_level)
   return Schedule(w, h, div_level, id_generator);
 }
 
+Schedule
+MakeTiledSchedule(size_t w, size_t h, size_t tile_size)
+{
+  IDGenerator id_generator;
+
+  return Schedule(ScheduleLayout::CreateTiled(w, h, tile_size), id_generator);
+}
+
 } // namespace
 
 TEST(Schedule, GetPartitionCount)
@@ -76,58 +83,6 @@ TEST(Schedule, GetTextureSize6)
   EXPECT_EQ(schedule.GetTextureHeight(), 16);
 }
 
-namespace {
-
-std::string
-Print(const std::vector<Vertex>& vertices)
-{
-  std::ostringstream stream;
-
-  for (const auto& vert : vertices)
-    stream << vert << '\n';
-
-  return stream.str();
-}
-
-} // namespace
-
-TEST(Schedule, GetVertexBuffer)
-{
-  static_assert(sizeof(Vertex) == (sizeof(float) * 4));
-
-  Schedule schedule = MakeSchedule(2, 2, 0);
-
-  std::vector<Vertex> vertices = schedule.GetVertexBuffer();
-
-  std::string out = Print(vertices);
-
-  EXPECT_EQ(out,
-            "(0, 0)\n"
-            "(0, 0.5)\n"
-            "(0.5, 0)\n"
-            "(0, 0.5)\n"
-            "(0.5, 0.5)\n"
-            "(0.5, 0)\n"
-            "(0.5, 0)\n"
-            "(0.5, 0.5)\n"
-            "(1, 0)\n"
-            "(0.5, 0.5)\n"
-            "(1, 0.5)\n"
-            "(1, 0)\n"
-            "(0, 0.5)\n"
-            "(0, 1)\n"
-            "(0.5, 0.5)\n"
-            "(0, 1)\n"
-            "(0.5, 1)\n"
-            "(0.5, 0.5)\n"
-            "(0.5, 0.5)\n"
-            "(0.5, 1)\n"
-            "(1, 0.5)\n"
-            "(0.5, 1)\n"
-            "(1, 1)\n"
-            "(1, 0.5)\n");
-}
-
 TEST(Schedule, GetStride)
 {
   Schedule schedule = MakeSchedule(3, 5, 0);
@@ -379,3 +334,309 @@ TEST(Schedule, GetPreviewOperations6)
             "offset = (2, 3); stride = (4, 4)\n"
             "offset = (3, 3); stride = (4, 4)\n");
 }
+
+TEST(Schedule, FindRenderRequest)
+{
+  IDGenerator id_generator;
+
+  id_generator.GenerateID();
+
+  Schedule schedule(16, 8, 2, id_generator);
+
+  EXPECT_EQ(schedule.FindRenderRequest(0), std::nullopt);
+  EXPECT_EQ(schedule.FindRenderRequest(1), 0);
+  EXPECT_EQ(schedule.FindRenderRequest(16), 15);
+  EXPECT_EQ(schedule.FindRenderRequest(17), std::nullopt);
+}
+
+TEST(Schedule, CompleteOutOfOrder)
+{
+  Schedule schedule = MakeSchedule(16, 8, 2);
+
+  EXPECT_TRUE(schedule.CompleteRenderRequest(3));
+  EXPECT_TRUE(schedule.CompleteRenderRequest(1));
+  EXPECT_TRUE(schedule.CompleteRenderRequest(2));
+
+  EXPECT_FALSE(schedule.CompleteRenderRequest(2));
+  EXPECT_FALSE(schedule.CompleteRenderRequest(16));
+
+  EXPECT_TRUE(schedule.IsRenderRequestComplete(1));
+  EXPECT_FALSE(schedule.IsRenderRequestComplete(0));
+
+  EXPECT_EQ(schedule.GetRemainingRenderRequests(), 13);
+
+  // The first preview needs the first render request.
+  EXPECT_FALSE(schedule.HasPreview());
+  EXPECT_EQ(schedule.GetRenderRequest().id, 0);
+
+  EXPECT_TRUE(schedule.CompleteRenderRequest(0));
+
+  EXPECT_EQ(schedule.GetPreviewIndex(), 1);
+  EXPECT_EQ(schedule.GetPreviewOperations().size(), 4);
+  EXPECT_EQ(schedule.GetRenderRequest().id, 4);
+}
+
+TEST(Schedule, CompleteLastPreviewOutOfOrder)
+{
+  Schedule schedule = MakeSchedule(16, 8, 2);
+
+  for (size_t i = 16; i > 1; i--)
+    schedule.CompleteRenderRequest(i - 1);
+
+  EXPECT_FALSE(schedule.HasPreview());
+
+  schedule.CompleteRenderRequest(0);
+
+  EXPECT_EQ(schedule.GetPreviewOperations().size(), 16);
+  EXPECT_EQ(schedule.GetRemainingRenderRequests(), 0);
+  EXPECT_FALSE(schedule.GetRenderRequest().IsValid());
+}
+
+namespace {
+
+/// Completes the render request of a schedule at the given offset.
+void
+CompleteAtOffset(Schedule& schedule, size_t x, size_t y)
+{
+  for (size_t i = 0; i < schedule.GetRenderRequestCount(); i++) {
+
+    const RenderRequest req = schedule.GetRenderRequest(i);
+
+    if ((req.x_pixel_offset == x) && (req.y_pixel_offset == y))
+      schedule.CompleteRenderRequest(i);
+  }
+}
+
+} // namespace
+
+TEST(Schedule, CompleteCoveredRequests_HigherLevel)
+{
+  Schedule previous = MakeSchedule(16, 8, 1);
+
+  CompleteAtOffset(previous, 0, 0);
+  CompleteAtOffset(previous, 1, 1);
+
+  Schedule schedule = MakeSchedule(16, 8, 2);
+
+  EXPECT_EQ(schedule.CompleteCoveredRequests(previous), 8);
+
+  // The requests at offsets (0, 0), (2, 0), (0, 2) and (2, 2) come first.
+  EXPECT_EQ(schedule.GetPreviewIndex(), 1);
+
+  EXPECT_TRUE(schedule.IsRenderRequestComplete(0));
+
+  const RenderRequest req = schedule.GetRenderRequest();
+
+  EXPECT_EQ(req.x_pixel_offset % 2, 1);
+  EXPECT_EQ(req.y_pixel_offset % 2, 0);
+}
+
+TEST(Schedule, CompleteCoveredRequests_LowerLevel)
+{
+  // The frame is padded more at the higher level, so its render requests
+  // reach as far as the ones at the lower level.
+  Schedule previous = MakeSchedule(6, 6, 2);
+
+  CompleteAtOffset(previous, 0, 0);
+  CompleteAtOffset(previous, 2, 0);
+  CompleteAtOffset(previous, 0, 2);
+  CompleteAtOffset(previous, 2, 2);
+  CompleteAtOffset(previous, 1, 0);
+
+  Schedule schedule = MakeSchedule(6, 6, 1);
+
+  EXPECT_EQ(schedule.CompleteCoveredRequests(previous), 1);
+
+  EXPECT_TRUE(schedule.IsRenderRequestComplete(0));
+
+  EXPECT_EQ(schedule.GetRemainingRenderRequests(), 3);
+}
+
+TEST(Schedule, CompleteCoveredRequests_UnevenWidth)
+{
+  // At a width of 100, the render requests at level 2 end at an offset of 92
+  // and the ones at level 1 at an offset of 96.
+  Schedule previous = MakeSchedule(100, 8, 2);
+
+  for (size_t i = 0; i < previous.GetRenderRequestCount(); i++)
+    previous.CompleteRenderRequest(i);
+
+  Schedule schedule = MakeSchedule(100, 8, 1);
+
+  EXPECT_EQ(schedule.CompleteCoveredRequests(previous), 0);
+
+  EXPECT_FALSE(schedule.HasPreview());
+
+  // The other way around, every pixel was received.
+  Schedule next = MakeSchedule(100, 8, 2);
+
+  for (size_t i = 0; i < schedule.GetRenderRequestCount(); i++)
+    schedule.CompleteRenderRequest(i);
+
+  EXPECT_EQ(next.CompleteCoveredRequests(schedule), 16);
+}
+
+TEST(Schedule, CompleteCoveredRequests_DifferentSize)
+{
+  Schedule previous = MakeSchedule(16, 8, 1);
+
+  previous.CompleteRenderRequest(0);
+
+  Schedule schedule = MakeSchedule(16, 16, 2);
+
+  EXPECT_EQ(schedule.CompleteCoveredRequests(previous), 0);
+}
+
+TEST(Schedule, Tiled_GetSize)
+{
+  const Schedule schedule = MakeTiledSchedule(40, 20, 16);
+
+  EXPECT_TRUE(schedule.IsTiled());
+  EXPECT_EQ(schedule.GetTileSize(), 16);
+
+  EXPECT_EQ(schedule.GetFrameWidth(), 40);
+  EXPECT_EQ(schedule.GetFrameHeight(), 20);
+
+  // Padded to a whole number of tiles.
+  EXPECT_EQ(schedule.GetTextureWidth(), 48);
+  EXPECT_EQ(schedule.GetTextureHeight(), 32);
+
+  EXPECT_EQ(schedule.GetPartitionWidth(), 16);
+  EXPECT_EQ(schedule.GetPartitionHeight(), 16);
+
+  EXPECT_EQ(schedule.GetRenderRequestCount(), 6);
+  EXPECT_EQ(schedule.GetPartitionCount(), 6);
+  EXPECT_EQ(schedule.GetPreviewCount(), 6);
+
+  EXPECT_EQ(schedule.GetHorizontalStride(), 1);
+  EXPECT_EQ(schedule.GetVerticalStride(), 1);
+}
+
+TEST(Schedule, Tiled_MortonOrder)
+{
+  const Schedule schedule = MakeTiledSchedule(24, 24, 8);
+
+  const size_t expected[9][2] = { { 0, 0 },   { 8, 0 },  { 0, 8 },
+                                  { 8, 8 },   { 16, 0 }, { 16, 8 },
+                                  { 0, 16 },  { 8, 16 }, { 16, 16 } };
+
+  ASSERT_EQ(schedule.GetRenderRequestCount(), 9);
+
+  for (size_t i = 0; i < 9; i++) {
+
+    const RenderRequest req = schedule.GetRenderRequest(i);
+
+    EXPECT_EQ(req.id, i);
+    EXPECT_EQ(req.x_pixel_offset, expected[i][0]);
+    EXPECT_EQ(req.y_pixel_offset, expected[i][1]);
+    EXPECT_EQ(req.x_pixel_count, 8);
+    EXPECT_EQ(req.y_pixel_count, 8);
+    EXPECT_EQ(req.x_pixel_stride, 1);
+    EXPECT_EQ(req.y_pixel_stride, 1);
+    EXPECT_EQ(req.x_frame_size, 24);
+    EXPECT_EQ(req.y_frame_size, 24);
+  }
+}
+
+TEST(Schedule, Tiled_Preview)
+{
+  Schedule schedule = MakeTiledSchedule(16, 16, 8);
+
+  EXPECT_FALSE(schedule.HasPreview());
+  EXPECT_TRUE(schedule.GetPreviewOperations().empty());
+
+  // Each complete tile is a new preview, even if earlier tiles are missing.
+  schedule.CompleteRenderRequest(2);
+
+  ASSERT_TRUE(schedule.HasPreview());
+  EXPECT_EQ(schedule.GetPreviewIndex(), 0);
+  EXPECT_EQ(schedule.GetPreviewStride(), 1);
+
+  const auto& ops = schedule.GetPreviewOperations();
+
+  ASSERT_EQ(ops.size(), 1);
+  EXPECT_EQ(ops[0].x_pixel_offset, 0);
+  EXPECT_EQ(ops[0].y_pixel_offset, 0);
+  EXPECT_EQ(ops[0].x_pixel_stride, 1);
+  EXPECT_EQ(ops[0].y_pixel_stride, 1);
+
+  schedule.CompleteRenderRequest(0);
+
+  EXPECT_EQ(schedule.GetPreviewIndex(), 1);
+  EXPECT_EQ(schedule.GetRemainingRenderRequests(), 2);
+}
+
+TEST(Schedule, Tiled_CompleteCoveredRequests)
+{
+  Schedule previous = MakeSchedule(16, 16, 1);
+
+  previous.CompleteRenderRequest(0);
+
+  Schedule schedule = MakeTiledSchedule(16, 16, 8);
+
+  EXPECT_EQ(schedule.CompleteCoveredRequests(previous), 0);
+  EXPECT_EQ(previous.CompleteCoveredRequests(schedule), 0);
+}
+
+TEST(ScheduleCache, SharesLayout)
+{
+  ScheduleCache cache;
+
+  auto layout = cache.GetLayout(16, 8, 2);
+
+  EXPECT_EQ(cache.GetLayout(16, 8, 2), layout);
+  EXPECT_NE(cache.GetLayout(16, 8, 1), layout);
+  EXPECT_NE(cache.GetLayout(16, 16, 2), layout);
+}
+
+TEST(ScheduleCache, MakeSchedule)
+{
+  ScheduleCache cache;
+
+  IDGenerator id_generator;
+
+  Schedule first = cache.MakeSchedule(16, 8, 2, id_generator);
+  Schedule second = cache.MakeSchedule(16, 8, 2, id_generator);
+
+  const Schedule uncached = MakeSchedule(16, 8, 2);
+
+  ASSERT_EQ(second.GetRenderRequestCount(), uncached.GetRenderRequestCount());
+
+  for (size_t i = 0; i < second.GetRenderRequestCount(); i++) {
+
+    const RenderRequest a = second.GetRenderRequest(i);
+    const RenderRequest b = uncached.GetRenderRequest(i);
+
+    // Each schedule has its own IDs.
+    EXPECT_EQ(a.id, first.GetRenderRequestCount() + i);
+    EXPECT_EQ(second.FindRenderRequest(a.id), i);
+    EXPECT_FALSE(first.FindRenderRequest(a.id));
+
+    EXPECT_EQ(a.x_pixel_offset, b.x_pixel_offset);
+    EXPECT_EQ(a.y_pixel_offset, b.y_pixel_offset);
+    EXPECT_EQ(a.x_pixel_count, b.x_pixel_count);
+    EXPECT_EQ(a.y_pixel_count, b.y_pixel_count);
+  }
+
+  // The completed requests are not shared.
+  first.NextRenderRequest();
+
+  EXPECT_EQ(second.GetRemainingRenderRequests(), 16);
+}
+
+TEST(ScheduleCache, MakeTiledSchedule)
+{
+  ScheduleCache cache;
+
+  IDGenerator id_generator;
+
+  EXPECT_NE(cache.GetTiledLayout(16, 16, 8), cache.GetLayout(16, 16, 0));
+  EXPECT_NE(cache.GetTiledLayout(16, 16, 8), cache.GetTiledLayout(16, 16, 4));
+  EXPECT_EQ(cache.GetTiledLayout(16, 16, 8), cache.GetTiledLayout(16, 16, 8));
+
+  const Schedule first = cache.MakeTiledSchedule(16, 16, 8, id_generator);
+  const Schedule second = cache.MakeTiledSchedule(16, 16, 8, id_generator);
+
+  EXPECT_TRUE(second.IsTiled());
+  EXPECT_EQ(second.GetRenderRequest(0).id, first.GetRenderRequestCount());
+}
@@ -0,0 +1,24 @@
+#version 330 core
+
+out vec4 color;
+
+uniform sampler2D frame;
+
+/// The weight of the frame in the average, which is one over the number of
+/// frames averaged so far, including this one.
+uniform float weight = 1.0;
+
+in vec2 frame_coords;
+
+void
+main()
+{
+  ivec2 pixel = ivec2(floor(frame_coords));
+
+  // Both textures have the first row of the frame as their last row, and are
+  // aligned at that row.
+  ivec2 source = ivec2(pixel.x, textureSize(frame, 0).y - 1 - pixel.y);
+
+  // Blended with the average so far by the alpha.
+  color = vec4(texelFetch(frame, source, 0).rgb, weight);
+}
@@ -0,0 +1,23 @@
+#version 330 core
+
+uniform float x_frame_size = 0.0;
+uniform float y_frame_size = 0.0;
+
+/// The position within the frame, in units of frame pixels, with the origin
+/// at the top left corner.
+out vec2 frame_coords;
+
+void
+main()
+{
+  // A single triangle that covers the whole viewport, so that no vertex data
+  // is needed.
+  vec2 ndc = vec2(float((gl_VertexID & 1) << 2) - 1.0,
+                  float((gl_VertexID & 2) << 1) - 1.0);
+
+  vec2 frame_size = vec2(x_frame_size, y_frame_size);
+
+  frame_coords = vec2(ndc.x + 1.0, 1.0 - ndc.y) * 0.5 * frame_size;
+
+  gl_Position = vec4(ndc, 0.0, 1.0);
+}
@@ -0,0 +1,27 @@
+#version 330 core
+
+out vec4 color;
+
+uniform sampler2D frame;
+
+/// The distance between the pixels that have been received for the current
+/// preview. Each of them fills the square of pixels to its bottom right.
+uniform float preview_stride = 1.0;
+
+in vec2 frame_coords;
+
+void
+main()
+{
+  int stride = int(preview_stride);
+
+  ivec2 pixel = ivec2(floor(frame_coords));
+
+  ivec2 source = (pixel / stride) * stride;
+
+  // The frame was rendered with its first row at the top of the viewport,
+  // which is the last row of its texture.
+  source.y = textureSize(frame, 0).y - 1 - source.y;
+
+  color = texelFetch(frame, source, 0);
+}
@@ -0,0 +1,38 @@
+#version 330 core
+
+out vec4 color;
+
+uniform sampler2DArray partitions;
+
+/// The layer of the partition array that holds the reply.
+uniform int layer = 0;
+
+uniform float x_pixel_offset = 0.0;
+uniform float y_pixel_offset = 0.0;
+
+uniform float x_pixel_stride = 1.0;
+uniform float y_pixel_stride = 1.0;
+
+in vec2 frame_coords;
+
+void
+main()
+{
+  ivec2 offset = ivec2(x_pixel_offset, y_pixel_offset);
+
+  ivec2 stride = ivec2(x_pixel_stride, y_pixel_stride);
+
+  ivec2 pixel = ivec2(floor(frame_coords)) - offset;
+
+  // Only the pixels on the strided grid of this partition are written.
+  if (any(lessThan(pixel, ivec2(0))) || any(notEqual(pixel % stride, ivec2(0))))
+    discard;
+
+  ivec2 texel = pixel / stride;
+
+  // Tiles only cover part of the frame.
+  if (any(greaterThanEqual(texel, textureSize(partitions, 0).xy)))
+    discard;
+
+  color = texelFetch(partitions, ivec3(texel, layer), 0);
+}
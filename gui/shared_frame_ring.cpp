@@ -0,0 +1,113 @@
+#include "shared_frame_ring.hpp"
+
+#include "frame_header.hpp"
+
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace vision::gui {
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "The consumed position has to be usable across processes.");
+
+auto
+SharedFrameRing::Create(size_t capacity) -> std::unique_ptr<SharedFrameRing>
+{
+  if (!capacity)
+    return nullptr;
+
+  const int fd = ::memfd_create("vision-frame-ring", MFD_CLOEXEC);
+
+  if (fd < 0)
+    return nullptr;
+
+  const size_t mapping_size = data_offset + capacity;
+
+  if (::ftruncate(fd, off_t(mapping_size)) != 0) {
+    ::close(fd);
+    return nullptr;
+  }
+
+  void* mapping = ::mmap(
+    nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  if (mapping == MAP_FAILED) {
+    ::close(fd);
+    return nullptr;
+  }
+
+  unsigned char* bytes = (unsigned char*)mapping;
+
+  detail::EncodeLittleEndian(magic_number, bytes);
+  detail::EncodeLittleEndian(version, bytes + 4);
+  detail::EncodeLittleEndian(uint64_t(capacity), bytes + 8);
+
+  new (bytes + consumed_offset) std::atomic<uint64_t>(0);
+
+  return std::unique_ptr<SharedFrameRing>(
+    new SharedFrameRing(fd, bytes, capacity));
+}
+
+SharedFrameRing::SharedFrameRing(int fd,
+                                 unsigned char* mapping,
+                                 size_t capacity)
+  : m_fd(fd)
+  , m_mapping(mapping)
+  , m_capacity(capacity)
+{}
+
+SharedFrameRing::~SharedFrameRing()
+{
+  ::munmap(m_mapping, data_offset + m_capacity);
+
+  ::close(m_fd);
+}
+
+bool
+SharedFrameRing::SetInheritable(bool inheritable)
+{
+  return ::fcntl(m_fd, F_SETFD, inheritable ? 0 : FD_CLOEXEC) == 0;
+}
+
+uint64_t
+SharedFrameRing::GetConsumedPosition() const noexcept
+{
+  return GetConsumed().load(std::memory_order_acquire);
+}
+
+auto
+SharedFrameRing::GetPayload(uint64_t position, size_t size)
+  -> const unsigned char*
+{
+  const uint64_t consumed = GetConsumedPosition();
+
+  const uint64_t offset = position % m_capacity;
+
+  // The payload has to be in the part of the ring the renderer is allowed to
+  // write to, and may not wrap around the end of it.
+  if ((position < consumed) || (size > m_capacity) ||
+      ((position + size - consumed) > m_capacity) ||
+      ((offset + size) > m_capacity))
+    return nullptr;
+
+  return GetData() + offset;
+}
+
+void
+SharedFrameRing::Release(uint64_t end_position)
+{
+  if (end_position > GetConsumedPosition())
+    GetConsumed().store(end_position, std::memory_order_release);
+}
+
+std::atomic<uint64_t>&
+SharedFrameRing::GetConsumed() const noexcept
+{
+  return *std::launder(
+    reinterpret_cast<std::atomic<uint64_t>*>(m_mapping + consumed_offset));
+}
+
+} // namespace vision::gui
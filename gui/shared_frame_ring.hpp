@@ -0,0 +1,90 @@
+#pragma once
+
+#include "response.hpp"
+
+#include <atomic>
+#include <memory>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace vision::gui {
+
+/// A ring of shared memory that a locally spawned renderer writes pixels into,
+/// so that only frame headers pass through its standard output. The memory is
+/// created with memfd_create and is only available on Linux.
+///
+/// The file descriptor of the ring is passed to the renderer in the
+/// environment variable "VISION_FRAME_RING_FD". Once the renderer has switched
+/// to the binary protocol, it may reply with shared RGB buffer frames. The
+/// memory is laid out as follows, with every integer in little endian:
+///
+///   - At offset 0, the magic number "VSHM" as an unsigned 32-bit integer,
+///     followed by the version (1) as an unsigned 32-bit integer and the
+///     capacity of the data region as an unsigned 64-bit integer.
+///   - At offset 64, the consumed position, an unsigned 64-bit integer that
+///     this process atomically updates as it is done reading payloads.
+///   - At offset 4096, the data region.
+///
+/// Positions count bytes since the ring was created. A payload at position P
+/// occupies the data region from P modulo the capacity, and may not wrap
+/// around the end of the data region. A renderer skips ahead to the next
+/// multiple of the capacity instead. A renderer may only write a payload once
+/// the consumed position is at least P plus the payload size minus the
+/// capacity.
+class SharedFrameRing final : public SharedPayloadSource
+{
+public:
+  static constexpr uint32_t magic_number = 0x4d485356;
+
+  static constexpr uint32_t version = 1;
+
+  static constexpr size_t consumed_offset = 64;
+
+  static constexpr size_t data_offset = 4096;
+
+  /// The default capacity, which fits a few 4K frames.
+  static constexpr size_t default_capacity = 134217728;
+
+  /// @return A new ring, or null if the shared memory could not be created.
+  static auto Create(size_t capacity = default_capacity)
+    -> std::unique_ptr<SharedFrameRing>;
+
+  SharedFrameRing(const SharedFrameRing&) = delete;
+
+  SharedFrameRing& operator=(const SharedFrameRing&) = delete;
+
+  ~SharedFrameRing();
+
+  int GetFd() const noexcept { return m_fd; }
+
+  /// Sets whether or not the file descriptor is inherited by child processes.
+  /// It should only be inheritable while the renderer is being started.
+  bool SetInheritable(bool inheritable);
+
+  size_t GetCapacity() const noexcept { return m_capacity; }
+
+  /// @return The beginning of the data region, where renderers write pixels.
+  unsigned char* GetData() noexcept { return m_mapping + data_offset; }
+
+  uint64_t GetConsumedPosition() const noexcept;
+
+  auto GetPayload(uint64_t position, size_t size)
+    -> const unsigned char* override;
+
+  void Release(uint64_t end_position) override;
+
+private:
+  SharedFrameRing(int fd, unsigned char* mapping, size_t capacity);
+
+  std::atomic<uint64_t>& GetConsumed() const noexcept;
+
+private:
+  int m_fd;
+
+  unsigned char* m_mapping;
+
+  size_t m_capacity;
+};
+
+} // namespace vision::gui
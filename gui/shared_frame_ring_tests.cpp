@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+
+#include "shared_frame_ring.hpp"
+
+#include <fcntl.h>
+
+using namespace vision::gui;
+
+TEST(SharedFrameRing, Header)
+{
+  std::unique_ptr<SharedFrameRing> ring = SharedFrameRing::Create(4096);
+
+  ASSERT_TRUE(ring);
+
+  const unsigned char* header =
+    ring->GetData() - SharedFrameRing::data_offset;
+
+  EXPECT_EQ(std::string((const char*)header, 4), "VSHM");
+  EXPECT_EQ(header[4], 1);
+  EXPECT_EQ(header[9], 0x10);
+
+  EXPECT_EQ(ring->GetConsumedPosition(), uint64_t(0));
+}
+
+TEST(SharedFrameRing, PayloadBounds)
+{
+  std::unique_ptr<SharedFrameRing> ring = SharedFrameRing::Create(100);
+
+  ASSERT_TRUE(ring);
+
+  EXPECT_EQ(ring->GetPayload(0, 100), ring->GetData());
+
+  EXPECT_EQ(ring->GetPayload(40, 10), ring->GetData() + 40);
+
+  // Payloads may not wrap around the end of the ring.
+  EXPECT_EQ(ring->GetPayload(95, 10), nullptr);
+
+  // Nor may they be further ahead than the renderer is allowed to write.
+  EXPECT_EQ(ring->GetPayload(100, 10), nullptr);
+
+  ring->Release(50);
+
+  EXPECT_EQ(ring->GetConsumedPosition(), uint64_t(50));
+
+  EXPECT_EQ(ring->GetPayload(100, 50), ring->GetData());
+
+  // Payloads that were already released are no longer valid.
+  EXPECT_EQ(ring->GetPayload(40, 10), nullptr);
+
+  // The consumed position never moves back.
+  ring->Release(20);
+
+  EXPECT_EQ(ring->GetConsumedPosition(), uint64_t(50));
+}
+
+TEST(SharedFrameRing, Inheritable)
+{
+  std::unique_ptr<SharedFrameRing> ring = SharedFrameRing::Create(4096);
+
+  ASSERT_TRUE(ring);
+
+  EXPECT_TRUE(::fcntl(ring->GetFd(), F_GETFD) & FD_CLOEXEC);
+
+  EXPECT_TRUE(ring->SetInheritable(true));
+
+  EXPECT_FALSE(::fcntl(ring->GetFd(), F_GETFD) & FD_CLOEXEC);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#include <stddef.h>
+
+namespace vision::gui {
+
+/// A bounded, lock-free queue for passing items from exactly one producer
+/// thread to exactly one consumer thread.
+template<typename T>
+class SpscQueue final
+{
+public:
+  /// @param capacity The maximum number of items in the queue.
+  SpscQueue(size_t capacity)
+    : m_slots(capacity + 1)
+  {}
+
+  SpscQueue(const SpscQueue&) = delete;
+
+  SpscQueue& operator=(const SpscQueue&) = delete;
+
+  size_t GetCapacity() const noexcept { return m_slots.size() - 1; }
+
+  /// Can only be called by the producer.
+  ///
+  /// @return True if the item was added, false if the queue is full. If the
+  ///         queue is full, the item is left untouched.
+  bool TryPush(T&& item)
+  {
+    const size_t tail = m_tail.load(std::memory_order_relaxed);
+
+    const size_t next = Next(tail);
+
+    if (next == m_head.load(std::memory_order_acquire))
+      return false;
+
+    m_slots[tail] = std::move(item);
+
+    m_tail.store(next, std::memory_order_release);
+
+    return true;
+  }
+
+  /// Can only be called by the consumer.
+  ///
+  /// @return True if an item was removed, false if the queue is empty.
+  bool TryPop(T& item)
+  {
+    const size_t head = m_head.load(std::memory_order_relaxed);
+
+    if (head == m_tail.load(std::memory_order_acquire))
+      return false;
+
+    item = std::move(m_slots[head]);
+
+    m_head.store(Next(head), std::memory_order_release);
+
+    return true;
+  }
+
+  /// Can be called by either thread, although the result may be out of date
+  /// by the time it is returned.
+  bool Empty() const noexcept
+  {
+    return m_head.load(std::memory_order_acquire) ==
+           m_tail.load(std::memory_order_acquire);
+  }
+
+private:
+  size_t Next(size_t index) const noexcept
+  {
+    return ((index + 1) == m_slots.size()) ? 0 : (index + 1);
+  }
+
+private:
+  std::vector<T> m_slots;
+
+  /// The index of the next item to pop, which is written by the consumer.
+  alignas(64) std::atomic<size_t> m_head{ 0 };
+
+  /// The index of the next slot to push to, which is written by the producer.
+  alignas(64) std::atomic<size_t> m_tail{ 0 };
+};
+
+} // namespace vision::gui
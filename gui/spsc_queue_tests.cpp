@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include "spsc_queue.hpp"
+
+#include <memory>
+#include <thread>
+
+using namespace vision::gui;
+
+TEST(SpscQueue, FirstInFirstOut)
+{
+  SpscQueue<int> queue(4);
+
+  EXPECT_TRUE(queue.Empty());
+
+  EXPECT_TRUE(queue.TryPush(1));
+  EXPECT_TRUE(queue.TryPush(2));
+  EXPECT_TRUE(queue.TryPush(3));
+
+  int item = 0;
+
+  EXPECT_TRUE(queue.TryPop(item));
+  EXPECT_EQ(item, 1);
+
+  EXPECT_TRUE(queue.TryPop(item));
+  EXPECT_EQ(item, 2);
+
+  EXPECT_TRUE(queue.TryPop(item));
+  EXPECT_EQ(item, 3);
+
+  EXPECT_FALSE(queue.TryPop(item));
+
+  EXPECT_TRUE(queue.Empty());
+}
+
+TEST(SpscQueue, Full)
+{
+  SpscQueue<std::unique_ptr<int>> queue(2);
+
+  EXPECT_TRUE(queue.TryPush(std::make_unique<int>(1)));
+  EXPECT_TRUE(queue.TryPush(std::make_unique<int>(2)));
+
+  std::unique_ptr<int> item = std::make_unique<int>(3);
+
+  EXPECT_FALSE(queue.TryPush(std::move(item)));
+
+  // A failed push should not take the item.
+  ASSERT_NE(item, nullptr);
+
+  EXPECT_TRUE(queue.TryPop(item));
+
+  EXPECT_EQ(*item, 1);
+
+  EXPECT_TRUE(queue.TryPush(std::make_unique<int>(3)));
+}
+
+TEST(SpscQueue, TwoThreads)
+{
+  SpscQueue<size_t> queue(16);
+
+  const size_t count = 100000;
+
+  std::thread producer([&queue] {
+    for (size_t i = 0; i < count; i++) {
+      while (!queue.TryPush(size_t(i)))
+        std::this_thread::yield();
+    }
+  });
+
+  size_t expected = 0;
+
+  while (expected < count) {
+
+    size_t item = 0;
+
+    if (!queue.TryPop(item)) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    ASSERT_EQ(item, expected);
+
+    expected++;
+  }
+
+  producer.join();
+}
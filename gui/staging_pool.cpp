@@ -0,0 +1,79 @@
+#include "staging_pool.hpp"
+
+#include <algorithm>
+
+namespace vision::gui {
+
+void
+StagingPool::Offer(const StagingBlock& block)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  m_blocks.emplace_back(block);
+}
+
+std::optional<StagingBlock>
+StagingPool::Take(size_t size)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto best = m_blocks.end();
+
+  for (auto it = m_blocks.begin(); it != m_blocks.end(); it++) {
+
+    if (it->capacity < size)
+      continue;
+
+    if ((best == m_blocks.end()) || (it->capacity < best->capacity))
+      best = it;
+  }
+
+  if (best == m_blocks.end())
+    return std::nullopt;
+
+  const StagingBlock block = *best;
+
+  m_blocks.erase(best);
+
+  return block;
+}
+
+std::vector<StagingBlock>
+StagingPool::Reclaim(size_t min_capacity, size_t max_capacity)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto first_reclaimed =
+    std::partition(m_blocks.begin(), m_blocks.end(), [&](const auto& block) {
+      return (block.capacity >= min_capacity) &&
+             (block.capacity <= max_capacity);
+    });
+
+  std::vector<StagingBlock> reclaimed(first_reclaimed, m_blocks.end());
+
+  m_blocks.erase(first_reclaimed, m_blocks.end());
+
+  return reclaimed;
+}
+
+std::vector<StagingBlock>
+StagingPool::ReclaimAll()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  std::vector<StagingBlock> reclaimed;
+
+  reclaimed.swap(m_blocks);
+
+  return reclaimed;
+}
+
+size_t
+StagingPool::GetAvailableCount() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  return m_blocks.size();
+}
+
+} // namespace vision::gui
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include <stddef.h>
+
+namespace vision::gui {
+
+/// A block of staging memory, such as a mapped pixel buffer object, that holds
+/// the payload of one reply.
+struct StagingBlock final
+{
+  /// Identifies the block to its owner.
+  size_t index = 0;
+
+  unsigned char* data = nullptr;
+
+  size_t capacity = 0;
+};
+
+/// Lends blocks of staging memory from the thread that owns them, such as the
+/// thread of a GL context, to a thread that writes payloads into them. A block
+/// is taken for one payload and goes back to its owner along with it. The
+/// owner offers the block again once it is done with the payload.
+class StagingPool final
+{
+public:
+  /// Makes a block available. Can be called from any thread.
+  void Offer(const StagingBlock& block);
+
+  /// Takes the smallest available block that can hold the given number of
+  /// bytes. Can be called from any thread.
+  std::optional<StagingBlock> Take(size_t size);
+
+  /// Takes back the available blocks whose capacity is outside of the given
+  /// range, so that their owner can replace them.
+  std::vector<StagingBlock> Reclaim(size_t min_capacity, size_t max_capacity);
+
+  /// Takes back every available block.
+  std::vector<StagingBlock> ReclaimAll();
+
+  size_t GetAvailableCount() const;
+
+private:
+  mutable std::mutex m_mutex;
+
+  std::vector<StagingBlock> m_blocks;
+};
+
+} // namespace vision::gui
@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+
+#include "staging_pool.hpp"
+
+using namespace vision::gui;
+
+namespace {
+
+StagingBlock
+MakeBlock(size_t index, size_t capacity)
+{
+  return StagingBlock{ index, nullptr, capacity };
+}
+
+} // namespace
+
+TEST(StagingPool, TakesSmallestBlockThatFits)
+{
+  StagingPool pool;
+
+  pool.Offer(MakeBlock(0, 64));
+  pool.Offer(MakeBlock(1, 16));
+  pool.Offer(MakeBlock(2, 32));
+
+  std::optional<StagingBlock> block = pool.Take(20);
+
+  ASSERT_TRUE(block);
+  EXPECT_EQ(block->index, 2);
+
+  block = pool.Take(20);
+
+  ASSERT_TRUE(block);
+  EXPECT_EQ(block->index, 0);
+
+  EXPECT_FALSE(pool.Take(20));
+
+  EXPECT_EQ(pool.GetAvailableCount(), 1);
+}
+
+TEST(StagingPool, OfferedAgain)
+{
+  StagingPool pool;
+
+  pool.Offer(MakeBlock(0, 16));
+
+  std::optional<StagingBlock> block = pool.Take(16);
+
+  ASSERT_TRUE(block);
+
+  EXPECT_FALSE(pool.Take(16));
+
+  pool.Offer(*block);
+
+  EXPECT_TRUE(pool.Take(16));
+}
+
+TEST(StagingPool, Reclaim)
+{
+  StagingPool pool;
+
+  pool.Offer(MakeBlock(0, 8));
+  pool.Offer(MakeBlock(1, 16));
+  pool.Offer(MakeBlock(2, 64));
+
+  const std::vector<StagingBlock> reclaimed = pool.Reclaim(16, 32);
+
+  ASSERT_EQ(reclaimed.size(), 2);
+
+  EXPECT_EQ(reclaimed[0].index + reclaimed[1].index, 2);
+
+  EXPECT_EQ(pool.GetAvailableCount(), 1);
+
+  EXPECT_EQ(pool.ReclaimAll().size(), 1);
+
+  EXPECT_EQ(pool.GetAvailableCount(), 0);
+}
@@ -0,0 +1,142 @@
+#include "tcp_view.hpp"
+
+#include <QTcpSocket>
+
+namespace vision::gui {
+
+class TcpViewImpl final
+{
+  friend TcpView;
+
+  TcpViewImpl(QTcpSocket* socket, const QString& address)
+    : m_socket(socket)
+    , m_address(address)
+  {}
+
+  QTcpSocket* m_socket;
+
+  QString m_address;
+};
+
+TcpView::TcpView(QWidget* parent, const QString& address)
+  : TcpView(parent, new QTcpSocket(parent), address)
+{}
+
+TcpView::TcpView(QWidget* parent, QTcpSocket* socket, const QString& address)
+  : ContentView(parent, socket)
+  , m_impl(new TcpViewImpl(socket, address))
+{
+  connect(socket, &QTcpSocket::connected, this, &TcpView::HandleConnected);
+}
+
+TcpView::~TcpView()
+{
+  // The socket may be the one emitting the signal that led to this view
+  // being deleted, so it is only closed here and deleted later.
+  m_impl->m_socket->disconnect();
+
+  m_impl->m_socket->abort();
+
+  m_impl->m_socket->deleteLater();
+
+  delete m_impl;
+}
+
+QTcpSocket*
+TcpView::GetSocket()
+{
+  return m_impl->m_socket;
+}
+
+bool
+TcpView::ConnectToRenderer()
+{
+  QString host;
+
+  quint16 port = 0;
+
+  if (!ParseTcpAddress(m_impl->m_address, &host, &port))
+    return false;
+
+  // Unbuffered, so that the socket never reads the responses itself when
+  // they are read on a dedicated thread instead.
+  m_impl->m_socket->connectToHost(
+    host, port, QIODevice::ReadWrite | QIODevice::Unbuffered);
+
+  return true;
+}
+
+void
+TcpView::ForceQuit()
+{
+  m_impl->m_socket->abort();
+}
+
+void
+TcpView::HandleConnected()
+{
+  QTcpSocket* socket = m_impl->m_socket;
+
+  TuneRendererSocket(*socket);
+
+  // The socket is still used to write commands and to report its state.
+  if (!ReadSocketDescriptor(socket->socketDescriptor()))
+    connect(socket, &QTcpSocket::readyRead, this, &TcpView::ReadIODevice);
+}
+
+void
+TcpView::HandleEndOfStream()
+{
+  // The socket does not read, so it would not notice the renderer is gone.
+  m_impl->m_socket->disconnectFromHost();
+}
+
+bool
+ParseTcpAddress(const QString& address, QString* host, quint16* port)
+{
+  const QString trimmed = address.trimmed();
+
+  const int separator = trimmed.lastIndexOf(':');
+
+  if (separator <= 0)
+    return false;
+
+  QString host_part = trimmed.left(separator);
+
+  if (host_part.startsWith('[') && host_part.endsWith(']'))
+    host_part = host_part.mid(1, host_part.size() - 2);
+  else if (host_part.contains(':'))
+    return false;
+
+  if (host_part.isEmpty())
+    return false;
+
+  bool ok = false;
+
+  const uint port_value = trimmed.mid(separator + 1).toUInt(&ok);
+
+  if (!ok || (port_value == 0) || (port_value > 65535))
+    return false;
+
+  *host = host_part;
+
+  *port = quint16(port_value);
+
+  return true;
+}
+
+void
+TuneRendererSocket(QAbstractSocket& socket)
+{
+  socket.setSocketOption(QAbstractSocket::LowDelayOption, 1);
+
+  socket.setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption,
+                         renderer_receive_buffer_size);
+
+  // Once the read buffer is full, the socket stops reading until it is
+  // drained, so that a renderer faster than the GUI is throttled by the
+  // kernel instead of growing the buffer.
+  socket.setReadBufferSize(renderer_receive_buffer_size);
+}
+
+} // namespace vision::gui
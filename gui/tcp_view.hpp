@@ -0,0 +1,63 @@
+#pragma once
+
+#include "content_view.hpp"
+
+#include <QtGlobal>
+
+class QAbstractSocket;
+class QTcpSocket;
+
+namespace vision::gui {
+
+class TcpViewImpl;
+
+/// Connects to a renderer over TCP, such as one running on a remote machine.
+/// The renderer speaks the same protocol as one that is spawned as a process.
+class TcpView : public ContentView
+{
+  Q_OBJECT
+public:
+  TcpView(QWidget* parent, const QString& address);
+
+  ~TcpView();
+
+  QTcpSocket* GetSocket();
+
+  /// Starts connecting to the renderer.
+  ///
+  /// @return False if the address is not valid, in which case no connection
+  ///         is attempted.
+  bool ConnectToRenderer();
+
+  void ForceQuit() override;
+
+protected slots:
+  void HandleConnected();
+
+  void HandleEndOfStream() override;
+
+private:
+  TcpView(QWidget* parent, QTcpSocket* socket, const QString& address);
+
+private:
+  TcpViewImpl* m_impl;
+};
+
+/// Splits an address of the form "host:port". The host may be a name, an IPv4
+/// address or an IPv6 address in square brackets.
+///
+/// @return False if the address is not of that form.
+bool
+ParseTcpAddress(const QString& address, QString* host, quint16* port);
+
+/// The size that the receive buffer of a renderer socket is set to, which
+/// lets a renderer stream large frames without waiting on the window.
+constexpr int renderer_receive_buffer_size = 8388608;
+
+/// Disables Nagle's algorithm, so that commands are sent as they are written,
+/// enlarges the receive buffer and bounds the read buffer of the socket.
+/// Should be called once the socket is connected.
+void
+TuneRendererSocket(QAbstractSocket& socket);
+
+} // namespace vision::gui
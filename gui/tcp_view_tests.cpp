@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+
+#include "response.hpp"
+#include "tcp_view.hpp"
+
+#include <QCoreApplication>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+#include <sstream>
+
+using namespace vision::gui;
+
+TEST(TcpView, ParseAddress)
+{
+  QString host;
+
+  quint16 port = 0;
+
+  EXPECT_TRUE(ParseTcpAddress("localhost:5000", &host, &port));
+  EXPECT_EQ(host, QString("localhost"));
+  EXPECT_EQ(port, 5000);
+
+  EXPECT_TRUE(ParseTcpAddress(" 10.0.0.2:80 ", &host, &port));
+  EXPECT_EQ(host, QString("10.0.0.2"));
+  EXPECT_EQ(port, 80);
+
+  EXPECT_TRUE(ParseTcpAddress("[::1]:65535", &host, &port));
+  EXPECT_EQ(host, QString("::1"));
+  EXPECT_EQ(port, 65535);
+}
+
+TEST(TcpView, ParseInvalidAddress)
+{
+  QString host;
+
+  quint16 port = 0;
+
+  EXPECT_FALSE(ParseTcpAddress("", &host, &port));
+  EXPECT_FALSE(ParseTcpAddress("localhost", &host, &port));
+  EXPECT_FALSE(ParseTcpAddress(":5000", &host, &port));
+  EXPECT_FALSE(ParseTcpAddress("localhost:", &host, &port));
+  EXPECT_FALSE(ParseTcpAddress("localhost:0", &host, &port));
+  EXPECT_FALSE(ParseTcpAddress("localhost:65536", &host, &port));
+  EXPECT_FALSE(ParseTcpAddress("localhost:port", &host, &port));
+  EXPECT_FALSE(ParseTcpAddress("::1:5000", &host, &port));
+}
+
+namespace {
+
+class ResponseLogger final : public ResponseObserver
+{
+public:
+  ResponseLogger(std::ostream& output)
+    : m_output(output)
+  {}
+
+  void OnInvalidResponse(const std::string_view& reason) override
+  {
+    m_output << "InvalidResponse: " << reason << '\n';
+  }
+
+  void OnBufferOverflow(size_t) override { m_output << "BufferOverflow\n"; }
+
+  void OnRGBBuffer(const unsigned char*, size_t w, size_t h, size_t id) override
+  {
+    m_output << "RGBBuffer " << w << ' ' << h << ' ' << id << '\n';
+  }
+
+private:
+  std::ostream& m_output;
+};
+
+} // namespace
+
+/// Uses a server on the loopback interface as a stand-in for a renderer.
+TEST(TcpView, LoopbackRenderer)
+{
+  int argc = 1;
+
+  char name[] = "run_tests";
+
+  char* argv[] = { name, nullptr };
+
+  QCoreApplication app(argc, argv);
+
+  QTcpServer server;
+
+  ASSERT_TRUE(server.listen(QHostAddress::LocalHost));
+
+  QTcpSocket socket;
+
+  socket.connectToHost(QHostAddress::LocalHost, server.serverPort());
+
+  ASSERT_TRUE(server.waitForNewConnection(5000));
+
+  QTcpSocket* renderer = server.nextPendingConnection();
+
+  ASSERT_NE(renderer, nullptr);
+
+  ASSERT_TRUE(socket.waitForConnected(5000));
+
+  TuneRendererSocket(socket);
+
+  EXPECT_EQ(socket.socketOption(QAbstractSocket::LowDelayOption).toInt(), 1);
+
+  EXPECT_EQ(socket.readBufferSize(), qint64(renderer_receive_buffer_size));
+
+  // The kernel may cap the size, but never below its default.
+  EXPECT_GT(
+    socket.socketOption(QAbstractSocket::ReceiveBufferSizeSocketOption).toInt(),
+    0);
+
+  socket.write("r 2 1 0 0 1 1 7\n");
+
+  ASSERT_TRUE(socket.waitForBytesWritten(5000));
+
+  ASSERT_TRUE(renderer->waitForReadyRead(5000));
+
+  EXPECT_EQ(renderer->readLine(), QByteArray("r 2 1 0 0 1 1 7\n"));
+
+  const QByteArray reply =
+    QByteArray("rgb buffer 2 1 7\n") + QByteArray(6, 'x');
+
+  renderer->write(reply);
+
+  ASSERT_TRUE(renderer->waitForBytesWritten(5000));
+
+  std::ostringstream stream;
+
+  ResponseLogger logger(stream);
+
+  std::unique_ptr<ResponseParser> parser = ResponseParser::Create(logger);
+
+  QByteArray received;
+
+  while (received.size() < reply.size()) {
+
+    ASSERT_TRUE(socket.waitForReadyRead(5000));
+
+    received += socket.readAll();
+  }
+
+  parser->Write(received.constData(), size_t(received.size()));
+
+  EXPECT_EQ(stream.str(), "RGBBuffer 2 1 7\n");
+}
@@ -0,0 +1,169 @@
+#include "unix_socket_view.hpp"
+
+#include <QLocalSocket>
+#include <QTimer>
+
+#ifdef __linux__
+#include "shared_frame_ring.hpp"
+
+#include <string.h>
+#include <sys/socket.h>
+#endif
+
+namespace vision::gui {
+
+class UnixSocketViewImpl final
+{
+  friend UnixSocketView;
+
+  UnixSocketViewImpl(QLocalSocket* socket, const QString& path)
+    : m_socket(socket)
+    , m_path(path)
+  {}
+
+  QLocalSocket* m_socket;
+
+  QString m_path;
+
+#ifdef __linux__
+  /// Owned by the response worker of the view.
+  SharedFrameRing* m_frame_ring = nullptr;
+#endif
+};
+
+UnixSocketView::UnixSocketView(QWidget* parent, const QString& path)
+  : UnixSocketView(parent, new QLocalSocket(parent), path)
+{}
+
+UnixSocketView::UnixSocketView(QWidget* parent,
+                               QLocalSocket* socket,
+                               const QString& path)
+  : ContentView(parent, socket)
+  , m_impl(new UnixSocketViewImpl(socket, path))
+{
+  connect(
+    socket, &QLocalSocket::connected, this, &UnixSocketView::HandleConnected);
+
+#ifdef __linux__
+  std::unique_ptr<SharedFrameRing> ring = SharedFrameRing::Create();
+
+  if (ring) {
+
+    m_impl->m_frame_ring = ring.get();
+
+    SetSharedPayloadSource(std::move(ring));
+  }
+#endif
+}
+
+UnixSocketView::~UnixSocketView()
+{
+  // The socket may be the one emitting the signal that led to this view
+  // being deleted, so it is only closed here and deleted later.
+  m_impl->m_socket->disconnect();
+
+  m_impl->m_socket->abort();
+
+  m_impl->m_socket->deleteLater();
+
+  delete m_impl;
+}
+
+QLocalSocket*
+UnixSocketView::GetSocket()
+{
+  return m_impl->m_socket;
+}
+
+void
+UnixSocketView::ConnectToRenderer()
+{
+  // Unbuffered, so that the socket never reads the responses itself when
+  // they are read on a dedicated thread instead.
+  m_impl->m_socket->connectToServer(m_impl->m_path,
+                                    QIODevice::ReadWrite |
+                                      QIODevice::Unbuffered);
+}
+
+void
+UnixSocketView::SendQuitCommand()
+{
+  QLocalSocket* socket = m_impl->m_socket;
+
+  // Deferred, since the socket may report being disconnected right away and
+  // the caller may not expect the view to be gone when this returns.
+  QTimer::singleShot(0, socket, [socket] { socket->disconnectFromServer(); });
+}
+
+void
+UnixSocketView::ForceQuit()
+{
+  m_impl->m_socket->abort();
+}
+
+void
+UnixSocketView::HandleConnected()
+{
+  QLocalSocket* socket = m_impl->m_socket;
+
+  // This is done before anything else is written, so that the line carrying
+  // the file descriptor is not interleaved with buffered commands.
+  SendFrameRing();
+
+  // The socket is still used to write commands and to report its state.
+  if (!ReadSocketDescriptor(socket->socketDescriptor())) {
+    connect(
+      socket, &QLocalSocket::readyRead, this, &UnixSocketView::ReadIODevice);
+  }
+}
+
+void
+UnixSocketView::HandleEndOfStream()
+{
+  // The socket does not read, so it would not notice the renderer is gone.
+  m_impl->m_socket->disconnectFromServer();
+}
+
+bool
+UnixSocketView::SendFrameRing()
+{
+#ifdef __linux__
+  if (!m_impl->m_frame_ring)
+    return false;
+
+  char line[] = "f\n";
+
+  iovec io{ line, 2 };
+
+  union
+  {
+    char buffer[CMSG_SPACE(sizeof(int))];
+    cmsghdr align;
+  } control;
+
+  memset(&control, 0, sizeof(control));
+
+  msghdr message{};
+  message.msg_iov = &io;
+  message.msg_iovlen = 1;
+  message.msg_control = control.buffer;
+  message.msg_controllen = sizeof(control.buffer);
+
+  cmsghdr* header = CMSG_FIRSTHDR(&message);
+  header->cmsg_level = SOL_SOCKET;
+  header->cmsg_type = SCM_RIGHTS;
+  header->cmsg_len = CMSG_LEN(sizeof(int));
+
+  const int ring_fd = m_impl->m_frame_ring->GetFd();
+
+  memcpy(CMSG_DATA(header), &ring_fd, sizeof(int));
+
+  const int socket_fd = int(m_impl->m_socket->socketDescriptor());
+
+  return ::sendmsg(socket_fd, &message, MSG_NOSIGNAL) == 2;
+#else
+  return false;
+#endif
+}
+
+} // namespace vision::gui
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "content_view.hpp"
+
+class QLocalSocket;
+
+namespace vision::gui {
+
+class UnixSocketViewImpl;
+
+/// Attaches to a renderer that is already running and listening on a Unix
+/// domain socket. Unlike a spawned renderer, the renderer is not asked to quit
+/// when the view disconnects, so reconnecting does not reload its scene.
+///
+/// On Linux, the shared frame ring is passed to the renderer right after
+/// connecting, as an SCM_RIGHTS message carrying the line "f". The renderer
+/// may then reply with shared frames, as a spawned renderer would.
+class UnixSocketView : public ContentView
+{
+  Q_OBJECT
+public:
+  UnixSocketView(QWidget* parent, const QString& path);
+
+  ~UnixSocketView();
+
+  QLocalSocket* GetSocket();
+
+  void ConnectToRenderer();
+
+  /// Closes the connection without asking the renderer to quit.
+  void SendQuitCommand() override;
+
+  void ForceQuit() override;
+
+protected slots:
+  void HandleConnected();
+
+  void HandleEndOfStream() override;
+
+private:
+  UnixSocketView(QWidget* parent, QLocalSocket* socket, const QString& path);
+
+  /// Sends the file descriptor of the shared frame ring to the renderer.
+  ///
+  /// @return False if there is no ring or it could not be sent.
+  bool SendFrameRing();
+
+private:
+  UnixSocketViewImpl* m_impl;
+};
+
+} // namespace vision::gui
@@ -1,25 +1,33 @@
 #include "view.hpp"
 
 #include "id_generator.hpp"
+#include "lru_cache.hpp"
 #include "resize_request.hpp"
 #include "schedule.hpp"
-#include "vertex.hpp"
+#include "staging_pool.hpp"
 
 #include <QKeyEvent>
 #include <QMouseEvent>
 #include <QOpenGLBuffer>
 #include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLFramebufferObject>
 #include <QOpenGLFunctions>
 #include <QOpenGLShader>
 #include <QOpenGLShaderProgram>
 #include <QOpenGLTexture>
+#include <QOpenGLVertexArrayObject>
+#include <QTimer>
 
+#include <algorithm>
 #include <map>
 #include <optional>
 #include <memory>
+#include <vector>
 
 #include <assert.h>
 #include <stdint.h>
+#include <string.h>
 
 #include <QDebug>
 
@@ -32,46 +40,422 @@ namespace vision::gui {
 
 namespace {
 
-struct RenderReply final
+/// How long the size of the view has to stay the same before a frame is made
+/// for the new size, in milliseconds. This keeps the renderer from being sent
+/// a new frame for every step of a window being dragged.
+constexpr int resize_idle_threshold = 100;
+
+/// How many frame textures are kept after their frames are done, so that the
+/// next frame of the same size does not have to allocate one.
+constexpr size_t frame_cache_capacity = 2;
+
+/// The most frames that are averaged together. Once the average has this many
+/// frames, no more are requested until it starts over.
+constexpr size_t max_accumulated_frames = 1024;
+
+/// The most memory that the staging buffers take, across all of them.
+constexpr size_t staging_budget = 64 * 1024 * 1024;
+
+/// The fewest and the most staging buffers, whatever the size of the replies.
+constexpr size_t min_staging_buffers = 2;
+
+constexpr size_t max_staging_buffers = 32;
+
+/// Pixel buffer objects that are mapped up front and lent to the response
+/// decoder through a staging pool, so that the decoder thread writes the
+/// pixels of replies straight into them. The GUI thread only unmaps a buffer
+/// and issues the upload from it, which the driver carries out without
+/// stalling. A fence is placed after the upload, and the buffer is mapped and
+/// lent again once the fence is signaled, which is checked without waiting.
+class StagingBuffers final
 {
-  QOpenGLTexture texture{ QOpenGLTexture::Target2D };
+public:
+  StagingBuffers() = default;
+
+  StagingBuffers(const StagingBuffers&) = delete;
 
-  RenderReply(const RenderRequest& req, const unsigned char* data)
-    : texture(QImage(data,
-                     req.x_pixel_count,
-                     req.y_pixel_count,
-                     req.x_pixel_count * 3,
-                     QImage::Format_RGB888),
-              QOpenGLTexture::DontGenerateMipMaps)
+  StagingBuffers& operator=(const StagingBuffers&) = delete;
+
+  /// Expects the context to be current. Deleting the buffers also unmaps
+  /// them.
+  ~StagingBuffers()
   {
-    texture.setMinMagFilters(QOpenGLTexture::Linear, QOpenGLTexture::Nearest);
+    SetPool(nullptr);
+
+    for (std::unique_ptr<Slot>& slot : m_slots) {
+      if (slot && slot->fence)
+        m_functions->glDeleteSync(slot->fence);
+    }
+  }
+
+  /// Lends the buffers to a pool, or takes back the ones that are available
+  /// if the pool is null. The buffers are only made by @ref Recycle, since
+  /// the context may not exist yet.
+  void SetPool(StagingPool* pool)
+  {
+    if (m_pool) {
+      for (const StagingBlock& block : m_pool->ReclaimAll())
+        m_slots[block.index]->state = SlotState::Mapped;
+    }
+
+    m_pool = pool;
+  }
+
+  /// Sets the size of the replies that the buffers have to hold. The buffers
+  /// that do not fit it are replaced as they become available.
+  void SetBlockSize(size_t size)
+  {
+    m_block_size = size;
+
+    m_target_count = size ? (staging_budget / size) : 0;
+    m_target_count = std::max(m_target_count, min_staging_buffers);
+    m_target_count = std::min(m_target_count, max_staging_buffers);
+  }
+
+  /// Maps the buffers whose uploads are done and lends them to the pool.
+  /// Expects the context to be current.
+  void Recycle(QOpenGLExtraFunctions& functions)
+  {
+    m_functions = &functions;
+
+    if (!m_pool || !m_block_size)
+      return;
+
+    const size_t max_capacity = m_block_size * 4;
+
+    for (const StagingBlock& block :
+         m_pool->Reclaim(m_block_size, max_capacity))
+      m_slots[block.index]->state = SlotState::Mapped;
+
+    if (m_slots.size() < m_target_count)
+      m_slots.resize(m_target_count);
+
+    for (size_t i = 0; i < m_slots.size(); i++) {
+
+      std::unique_ptr<Slot>& slot = m_slots[i];
+
+      if (!slot) {
+        if (i >= m_target_count)
+          continue;
+        slot.reset(new Slot());
+      }
+
+      if ((slot->state == SlotState::Uploading) && !IsUploadDone(*slot))
+        continue;
+
+      const bool fits = (slot->capacity >= m_block_size) &&
+                        (slot->capacity <= max_capacity) &&
+                        (i < m_target_count);
+
+      if ((slot->state == SlotState::Mapped) && !fits) {
+        slot->buffer.bind();
+        slot->buffer.unmap();
+        slot->buffer.release();
+        slot->data = nullptr;
+        slot->state = SlotState::Unmapped;
+      }
+
+      if (slot->state == SlotState::Unmapped) {
+
+        if (i >= m_target_count) {
+          slot.reset();
+          continue;
+        }
+
+        if (!fits)
+          Allocate(*slot);
+
+        if (!Map(*slot))
+          continue;
+      }
+
+      if (slot->state == SlotState::Mapped) {
+        m_pool->Offer(StagingBlock{ i, slot->data, slot->capacity });
+        slot->state = SlotState::Lent;
+      }
+    }
+  }
+
+  /// Binds the buffer of a block as the pixel unpack buffer, so that its
+  /// pixels can be uploaded from offset zero. Expects the context to be
+  /// current.
+  ///
+  /// @return False if the block is not lent out, or if its pixels were lost,
+  ///         in which case nothing is bound.
+  bool BeginUpload(size_t index)
+  {
+    Slot* slot = GetLentSlot(index);
+    if (!slot)
+      return false;
+
+    slot->buffer.bind();
+
+    slot->data = nullptr;
+
+    // The contents are undefined if unmapping fails, such as when the screen
+    // mode changes.
+    if (!slot->buffer.unmap()) {
+      slot->buffer.release();
+      slot->state = SlotState::Unmapped;
+      return false;
+    }
+
+    slot->state = SlotState::Uploading;
+
+    return true;
+  }
+
+  /// Fences the upload from a block and unbinds its buffer.
+  void EndUpload(QOpenGLExtraFunctions& functions, size_t index)
+  {
+    Slot& slot = *m_slots[index];
+
+    slot.fence = functions.glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    slot.buffer.release();
   }
+
+  /// Takes back a block whose pixels are not uploaded, which can be lent
+  /// again as it is.
+  void Return(size_t index)
+  {
+    if (Slot* slot = GetLentSlot(index))
+      slot->state = SlotState::Mapped;
+  }
+
+private:
+  enum class SlotState
+  {
+    /// Not mapped, and not in use by any upload.
+    Unmapped,
+    /// Mapped, but not lent out.
+    Mapped,
+    /// Mapped and lent to the pool, or to whoever took it from the pool.
+    Lent,
+    /// Unmapped, while an upload from it may still be in progress.
+    Uploading
+  };
+
+  struct Slot final
+  {
+    QOpenGLBuffer buffer{ QOpenGLBuffer::PixelUnpackBuffer };
+
+    size_t capacity = 0;
+
+    /// Where the buffer is mapped, while it is.
+    unsigned char* data = nullptr;
+
+    /// Signaled once the upload from the buffer is done.
+    GLsync fence = nullptr;
+
+    SlotState state = SlotState::Unmapped;
+  };
+
+  Slot* GetLentSlot(size_t index)
+  {
+    if ((index >= m_slots.size()) || !m_slots[index])
+      return nullptr;
+
+    Slot* slot = m_slots[index].get();
+
+    return (slot->state == SlotState::Lent) ? slot : nullptr;
+  }
+
+  bool IsUploadDone(Slot& slot)
+  {
+    if (slot.fence) {
+
+      const GLenum result = m_functions->glClientWaitSync(slot.fence, 0, 0);
+
+      if ((result != GL_ALREADY_SIGNALED) &&
+          (result != GL_CONDITION_SATISFIED))
+        return false;
+
+      m_functions->glDeleteSync(slot.fence);
+
+      slot.fence = nullptr;
+    }
+
+    slot.state = SlotState::Unmapped;
+
+    return true;
+  }
+
+  void Allocate(Slot& slot)
+  {
+    slot.buffer.destroy();
+
+    slot.buffer.create();
+
+    slot.buffer.setUsagePattern(QOpenGLBuffer::StreamDraw);
+
+    slot.buffer.bind();
+
+    slot.buffer.allocate(int(m_block_size));
+
+    slot.buffer.release();
+
+    slot.capacity = m_block_size;
+  }
+
+  bool Map(Slot& slot)
+  {
+    if (!slot.buffer.bind())
+      return false;
+
+    // The upload from the buffer is done, so the driver does not have to
+    // synchronize with it.
+    void* mapped = slot.buffer.mapRange(0,
+                                        int(slot.capacity),
+                                        QOpenGLBuffer::RangeWrite |
+                                          QOpenGLBuffer::RangeInvalidateBuffer |
+                                          QOpenGLBuffer::RangeUnsynchronized);
+
+    slot.buffer.release();
+
+    if (!mapped)
+      return false;
+
+    slot.data = static_cast<unsigned char*>(mapped);
+
+    slot.state = SlotState::Mapped;
+
+    return true;
+  }
+
+private:
+  std::vector<std::unique_ptr<Slot>> m_slots;
+
+  StagingPool* m_pool = nullptr;
+
+  QOpenGLExtraFunctions* m_functions = nullptr;
+
+  size_t m_block_size = 0;
+
+  /// The number of buffers that fit the budget at the current block size.
+  size_t m_target_count = 0;
 };
 
-class FrameBuildContext final
+/// The most layers that the partition array has. This is the least that
+/// OpenGL 3 guarantees.
+constexpr size_t max_partition_layers = 256;
+
+/// Holds the replies to the render requests of a frame, one layer for each
+/// render request, until they are scattered into the frame. The storage is
+/// kept from one frame to the next, and is only reallocated when the size of
+/// the render requests changes.
+///
+/// A reply is scattered as soon as it is complete, and the rows of only one
+/// reply are received at a time, so frames with more render requests than
+/// layers share them.
+class PartitionArray final
 {
 public:
-  FrameBuildContext(const QSize& size,
-                    size_t div_level,
-                    IDGenerator& id_generator)
-    : FrameBuildContext(size.width(), size.height(), div_level, id_generator)
-  {}
+  /// Makes room for the replies of a frame. Expects the context to be
+  /// current.
+  ///
+  /// @param w The number of pixels in each row of a reply.
+  ///
+  /// @param h The number of rows in a reply.
+  ///
+  /// @param layers The number of render requests in the frame.
+  void Reserve(size_t w, size_t h, size_t layers)
+  {
+    if (m_texture.isStorageAllocated() && (size_t(m_texture.width()) == w) &&
+        (size_t(m_texture.height()) == h) &&
+        (size_t(m_texture.layers()) >= layers))
+      return;
+
+    m_texture.destroy();
 
-  FrameBuildContext(size_t w,
-                    size_t h,
-                    size_t div_level,
-                    IDGenerator& id_generator)
-    : m_schedule(w, h, div_level, id_generator)
-    , m_vertex_buffer(QOpenGLBuffer::VertexBuffer)
+    m_texture.setSize(int(w), int(h));
+    m_texture.setLayers(int(layers));
+    m_texture.setMipLevels(1);
+    m_texture.setFormat(QOpenGLTexture::RGBA8_UNorm);
+    m_texture.allocateStorage(QOpenGLTexture::RGBA, QOpenGLTexture::UInt8);
+    m_texture.setMinMagFilters(QOpenGLTexture::Nearest,
+                               QOpenGLTexture::Nearest);
+  }
+
+  /// Uploads rows of a reply to its layer. Expects the context to be current.
+  ///
+  /// @param data The pixels, or their offset into the pixel unpack buffer if
+  ///             one is bound.
+  ///
+  /// @param has_alpha Whether the data has four bytes per pixel (RGBA)
+  ///                  instead of three (RGB).
+  void Upload(QOpenGLExtraFunctions& functions,
+              size_t layer,
+              size_t first_row,
+              size_t row_count,
+              const unsigned char* data,
+              bool has_alpha)
   {
-    InitVertexBuffer();
+    m_texture.bind();
+
+    // Rows of 24-bit pixels are not necessarily aligned to four bytes.
+    functions.glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    functions.glTexSubImage3D(GL_TEXTURE_2D_ARRAY,
+                              0,
+                              0,
+                              GLint(first_row),
+                              GLint(layer),
+                              m_texture.width(),
+                              GLsizei(row_count),
+                              1,
+                              has_alpha ? GL_RGBA : GL_RGB,
+                              GL_UNSIGNED_BYTE,
+                              data);
+
+    functions.glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    m_texture.release();
   }
 
-  size_t GetVertexCount() const
+  QOpenGLTexture& GetTexture() { return m_texture; }
+
+private:
+  QOpenGLTexture m_texture{ QOpenGLTexture::Target2DArray };
+};
+
+/// The textures of frames that are done, by their size.
+using FrameCache = LruCache<QSize, std::unique_ptr<QOpenGLFramebufferObject>>;
+
+/// Builds a frame out of the replies to its render requests. Each reply is
+/// scattered into a full resolution frame texture once, when it arrives, so
+/// that the cost of painting the frame does not depend on how many replies
+/// have been received. Expects the context to be current whenever a reply is
+/// passed to it, and when it is destroyed.
+class FrameBuildContext final
+{
+public:
+  /// @param frame_cache Where the frame texture is taken from, if there is
+  ///                    one of the same size, and returned to once this
+  ///                    frame is done.
+  ///
+  /// @param partitions Where the replies are uploaded before they are
+  ///                   scattered into the frame.
+  ///
+  /// @param program The program used to scatter the replies into the frame.
+  FrameBuildContext(Schedule schedule,
+                    FrameCache& frame_cache,
+                    PartitionArray& partitions,
+                    QOpenGLShaderProgram& program)
+    : m_schedule(std::move(schedule))
+    , m_frame_cache(frame_cache)
+    , m_partitions(partitions)
+    , m_program(program)
+  {}
+
+  FrameBuildContext(const FrameBuildContext&) = delete;
+
+  FrameBuildContext& operator=(const FrameBuildContext&) = delete;
+
+  ~FrameBuildContext()
   {
-    const size_t x_max = m_schedule.GetTextureWidth() - 1;
-    const size_t y_max = m_schedule.GetTextureHeight() - 1;
-    return x_max * y_max * 6;
+    if (m_frame)
+      m_frame_cache.Insert(m_frame->size(), std::move(m_frame));
   }
 
   ResizeRequest MakeResizeRequest() const
@@ -82,50 +466,263 @@ public:
                           m_schedule.GetTextureHeight() };
   }
 
-  QOpenGLBuffer& GetVertexBuffer() { return m_vertex_buffer; }
-
   RenderRequest GetRenderRequest() { return m_schedule.GetRenderRequest(); }
 
   const Schedule& GetSchedule() const { return m_schedule; }
 
-  bool ReplyRenderRequest(const RenderRequest& req, const unsigned char* data)
+  /// Finds a render request of this frame that has not been replied to yet.
+  ///
+  /// @return The index of the render request, if it is still outstanding.
+  std::optional<size_t> FindOutstandingRequest(size_t request_id) const
   {
-    if (m_render_replies.size() >= m_schedule.GetRenderRequestCount())
-      return false;
+    const std::optional<size_t> index =
+      m_schedule.FindRenderRequest(request_id);
 
-    m_render_replies.emplace_back(new RenderReply(req, data));
+    if (!index || m_schedule.IsRenderRequestComplete(*index))
+      return std::nullopt;
 
-    const std::optional<size_t> m_last_preview_index = m_preview_index;
+    return index;
+  }
 
-    m_schedule.NextRenderRequest();
+  /// Replies to one of the outstanding render requests. The replies may
+  /// arrive in any order.
+  ///
+  /// @return Whether or not a new preview is available.
+  bool ReplyRenderRequest(QOpenGLExtraFunctions& functions,
+                          size_t index,
+                          const RenderRequest& req,
+                          const RenderRequestReply& reply)
+  {
+    Prepare(functions);
 
-    m_preview_index = m_schedule.GetPreviewIndex();
+    UploadReply(functions, index, req, reply);
 
-    return m_preview_index != m_last_preview_index;
+    return ScatterReply(functions, index, req);
+  }
+
+  /// Allocates the textures that replies are uploaded and scattered into.
+  /// This has to be done before a pixel unpack buffer is bound, since the
+  /// allocations would otherwise read from it.
+  void Prepare(QOpenGLExtraFunctions& functions)
+  {
+    ReservePartitions();
+
+    GetFrame(functions);
   }
 
-  size_t GetReplyCount() { return m_render_replies.size(); }
+  /// Uploads a reply to its layer, which is all that is done while a pixel
+  /// unpack buffer may be bound. Expects @ref Prepare to have been called.
+  void UploadReply(QOpenGLExtraFunctions& functions,
+                   size_t index,
+                   const RenderRequest& req,
+                   const RenderRequestReply& reply)
+  {
+    m_partitions.Upload(functions,
+                        GetLayer(index),
+                        0,
+                        req.y_pixel_count,
+                        reply.data,
+                        reply.has_alpha);
+  }
+
+  /// Scatters an uploaded reply into the frame and completes its request.
+  ///
+  /// @return Whether or not a new preview is available.
+  bool ScatterReply(QOpenGLExtraFunctions& functions,
+                    size_t index,
+                    const RenderRequest& req)
+  {
+    Scatter(functions, index, req);
+
+    return CompleteRenderRequest(index);
+  }
+
+  /// Uploads rows of the reply to an outstanding render request. Once the
+  /// last row is uploaded, the render request is complete.
+  ///
+  /// @return False if the rows are out of order. Otherwise, whether or not
+  ///         a new preview is available.
+  bool ReplyRenderRequestRows(QOpenGLExtraFunctions& functions,
+                              size_t index,
+                              const RenderRequest& req,
+                              size_t first_row,
+                              const unsigned char* data,
+                              size_t row_count)
+  {
+    if (first_row == 0)
+      m_partial_index = index;
+
+    if ((m_partial_index != index) || (m_partial_next_row != first_row))
+      return false;
+
+    ReservePartitions();
+
+    m_partitions.Upload(
+      functions, GetLayer(index), first_row, row_count, data, false);
+
+    m_partial_next_row = first_row + row_count;
+
+    if (m_partial_next_row < req.y_pixel_count)
+      return false;
+
+    m_partial_index.reset();
+
+    m_partial_next_row = 0;
+
+    Scatter(functions, index, req);
 
-  QOpenGLTexture* GetTexture(size_t index)
+    return CompleteRenderRequest(index);
+  }
+
+  /// Keeps the pixels received by another frame of the same content and size,
+  /// which may be divided at another level. The render requests whose pixels
+  /// were all received are complete from the start.
+  void KeepPixels(QOpenGLFunctions& functions, const FrameBuildContext& other)
   {
-    return &m_render_replies.at(index)->texture;
+    if (!other.m_frame)
+      return;
+
+    if (!m_schedule.CompleteCoveredRequests(other.m_schedule))
+      return;
+
+    QOpenGLFramebufferObject& frame = GetFrame(functions);
+
+    const int w = other.m_frame->width();
+    const int h = other.m_frame->height();
+
+    // The frames are stored upside down, so they are aligned at the top row
+    // of the frame, which is the last row of the texture.
+    const QRect target_rect(0, frame.height() - h, w, h);
+
+    QOpenGLFramebufferObject::blitFramebuffer(
+      &frame, target_rect, other.m_frame.get(), QRect(0, 0, w, h));
+
+    if (m_schedule.HasPreview())
+      m_preview_index = m_schedule.GetPreviewIndex();
   }
 
+  /// Indicates whether the frame texture has enough of the frame to show.
+  bool HasPreview() const { return m_schedule.HasPreview() && m_frame; }
+
+  /// The texture containing the pixels of every reply received so far. This
+  /// is zero until the first reply is received.
+  GLuint GetFrameTexture() const { return m_frame ? m_frame->texture() : 0; }
+
 private:
-  void InitVertexBuffer()
+  /// Gets the frame texture, when the first reply is received. A texture
+  /// left by an earlier frame of the same size is reused.
+  QOpenGLFramebufferObject& GetFrame(QOpenGLFunctions& functions)
   {
-    std::vector<Vertex> vertices = m_schedule.GetVertexBuffer();
+    if (m_frame)
+      return *m_frame;
+
+    const QSize size(int(m_schedule.GetTextureWidth()),
+                     int(m_schedule.GetTextureHeight()));
+
+    if (auto frame = m_frame_cache.Take(size)) {
+      m_frame = std::move(*frame);
+    } else {
+      m_frame.reset(
+        new QOpenGLFramebufferObject(size,
+                                     QOpenGLFramebufferObject::NoAttachment,
+                                     GL_TEXTURE_2D,
+                                     GL_RGBA8));
+    }
 
-    bool success = m_vertex_buffer.create();
+    m_frame->bind();
 
-    assert(success);
+    functions.glClearColor(0, 0, 0, 1);
+
+    functions.glClear(GL_COLOR_BUFFER_BIT);
+
+    m_frame->release();
+
+    return *m_frame;
+  }
+
+  void ReservePartitions()
+  {
+    // Every render request of a frame has the same size.
+    const RenderRequest req = m_schedule.GetRenderRequest(0);
+
+    m_partitions.Reserve(
+      req.x_pixel_count,
+      req.y_pixel_count,
+      std::min(m_schedule.GetRenderRequestCount(), max_partition_layers));
+  }
+
+  static size_t GetLayer(size_t index) { return index % max_partition_layers; }
+
+  /// Writes the pixels of a reply to their place in the frame texture.
+  void Scatter(QOpenGLFunctions& functions,
+               size_t index,
+               const RenderRequest& req)
+  {
+    QOpenGLTexture& texture = m_partitions.GetTexture();
+
+    QOpenGLFramebufferObject& frame = GetFrame(functions);
+
+    GLint viewport[4]{};
+
+    functions.glGetIntegerv(GL_VIEWPORT, viewport);
 
-    success = m_vertex_buffer.bind();
+    frame.bind();
+
+    functions.glViewport(0, 0, frame.width(), frame.height());
+
+    bool success = m_program.bind();
 
     assert(success);
 
-    m_vertex_buffer.allocate(&vertices[0],
-                             vertices.size() * sizeof(vertices[0]));
+    m_program.setUniformValue("x_frame_size", float(frame.width()));
+    m_program.setUniformValue("y_frame_size", float(frame.height()));
+
+    m_program.setUniformValue("x_pixel_offset", float(req.x_pixel_offset));
+    m_program.setUniformValue("y_pixel_offset", float(req.y_pixel_offset));
+
+    m_program.setUniformValue("x_pixel_stride", float(req.x_pixel_stride));
+    m_program.setUniformValue("y_pixel_stride", float(req.y_pixel_stride));
+
+    m_program.setUniformValue("layer", int(GetLayer(index)));
+
+    // A tile only covers a small part of the frame, so the rest of it is not
+    // rasterized. The frame is upside down in the texture.
+    if (m_schedule.IsTiled()) {
+      functions.glEnable(GL_SCISSOR_TEST);
+      functions.glScissor(
+        GLint(req.x_pixel_offset),
+        GLint(frame.height()) - GLint(req.y_pixel_offset + req.y_pixel_count),
+        GLsizei(req.x_pixel_count),
+        GLsizei(req.y_pixel_count));
+    }
+
+    texture.bind();
+
+    functions.glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    if (m_schedule.IsTiled())
+      functions.glDisable(GL_SCISSOR_TEST);
+
+    texture.release();
+
+    m_program.release();
+
+    frame.release();
+
+    functions.glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+  }
+
+  /// @return Whether or not a new preview is available.
+  bool CompleteRenderRequest(size_t index)
+  {
+    const std::optional<size_t> m_last_preview_index = m_preview_index;
+
+    m_schedule.CompleteRenderRequest(index);
+
+    if (m_schedule.HasPreview())
+      m_preview_index = m_schedule.GetPreviewIndex();
+
+    return m_preview_index != m_last_preview_index;
   }
 
 private:
@@ -133,9 +730,21 @@ private:
 
   std::optional<size_t> m_preview_index;
 
-  QOpenGLBuffer m_vertex_buffer{ QOpenGLBuffer::VertexBuffer };
+  /// The frame, with the pixels of every reply received so far.
+  std::unique_ptr<QOpenGLFramebufferObject> m_frame;
+
+  FrameCache& m_frame_cache;
 
-  std::vector<std::unique_ptr<RenderReply>> m_render_replies;
+  PartitionArray& m_partitions;
+
+  QOpenGLShaderProgram& m_program;
+
+  /// The index of the render request whose rows are being received.
+  std::optional<size_t> m_partial_index;
+
+  /// The row expected next for the render request whose rows are being
+  /// received.
+  size_t m_partial_next_row = 0;
 };
 
 class ViewImpl : public View
@@ -149,6 +758,17 @@ public:
     setFocusPolicy(Qt::StrongFocus);
 
     setMouseTracking(true);
+
+    m_resize_timer.setSingleShot(true);
+
+    m_resize_timer.setInterval(resize_idle_threshold);
+
+    connect(&m_resize_timer, &QTimer::timeout, this, [this] {
+      DiscardAccumulation();
+      ResizeFrameBuildContext();
+      NotifyResize();
+      NotifyNewFrame();
+    });
   }
 
   ~ViewImpl() { makeCurrent(); }
@@ -183,21 +803,66 @@ public:
   {
     level = std::max(level, size_t(0));
     level = std::min(level, size_t(4));
+
+    if (level == m_div_level)
+      return;
+
     m_div_level = level;
+
+    if (!m_frame_build_context)
+      return;
+
+    // The content of the frame stays the same, so the pixels that were
+    // already received only have to be moved to the new partitions.
+    ResetFrameBuildContext(true);
+
+    update();
+
+    NotifyNewFrame();
   }
 
-  void NewFrame() override
+  void SetTileSize(size_t tile_size) override
   {
-    makeCurrent();
+    if (tile_size == m_tile_size)
+      return;
 
-    m_frame_build_context.reset(
-      new FrameBuildContext(size(), m_div_level, m_id_generator));
+    m_tile_size = tile_size;
 
-    doneCurrent();
+    if (!m_frame_build_context)
+      return;
+
+    // The frame is padded differently, so the renderer has to be resized.
+    ResetFrameBuildContext();
+
+    NotifyResize();
+
+    NotifyNewFrame();
+  }
+
+  void NewFrame() override
+  {
+    DiscardAccumulation();
+
+    ResetFrameBuildContext();
 
     NotifyNewFrame();
   }
 
+  void SetAccumulationEnabled(bool enabled) override
+  {
+    if (enabled == m_accumulation_enabled)
+      return;
+
+    m_accumulation_enabled = enabled;
+
+    DiscardAccumulation();
+
+    if (enabled && !HasRenderRequest() && m_frame_build_context)
+      StartNextAccumulatedFrame();
+
+    update();
+  }
+
   bool NeedsNewFrame() override { return false; }
 
   RenderRequest GetCurrentRenderRequest() const override
@@ -208,27 +873,113 @@ public:
       return m_frame_build_context->GetRenderRequest();
   }
 
+  void SetStagingPool(StagingPool* pool) override
+  {
+    m_staging.SetPool(pool);
+
+    if (!pool || !context())
+      return;
+
+    makeCurrent();
+
+    m_staging.Recycle(*context()->extraFunctions());
+
+    doneCurrent();
+  }
+
   bool ReplyRenderRequest(const unsigned char* data,
                           size_t size,
                           size_t request_id) override
+  {
+    const RenderRequestReply reply{ data, size, request_id, false };
+
+    return ReplyRenderRequests(&reply, 1) == 1;
+  }
+
+  size_t ReplyRenderRequests(const RenderRequestReply* replies,
+                             size_t count) override
   {
     makeCurrent();
 
-    const RenderRequest req = GetCurrentRenderRequest();
-    if (!req.IsValid())
+    QOpenGLVertexArrayObject::Binder vertex_array_binder(&m_vertex_array);
+
+    size_t accepted = 0;
+
+    bool preview_changed = false;
+
+    for (size_t i = 0; i < count; i++) {
+
+      const std::optional<bool> result = AcceptReply(replies[i]);
+
+      if (!result)
+        continue;
+
+      accepted++;
+
+      preview_changed |= *result;
+    }
+
+    QOpenGLExtraFunctions* functions = context()->extraFunctions();
+
+    if (accepted)
+      preview_changed |= AccumulateCompleteFrame(*functions);
+
+    m_staging.Recycle(*functions);
+
+    if (preview_changed)
+      update();
+
+    vertex_array_binder.release();
+
+    doneCurrent();
+
+    return accepted;
+  }
+
+  bool ReplyRenderRequestRows(size_t request_id,
+                              size_t first_row,
+                              const unsigned char* data,
+                              size_t size) override
+  {
+    if (!m_frame_build_context)
+      return false;
+
+    const std::optional<size_t> index =
+      m_frame_build_context->FindOutstandingRequest(request_id);
+    if (!index)
       return false;
 
-    if (req.id != request_id)
+    const RenderRequest req =
+      m_frame_build_context->GetSchedule().GetRenderRequest(*index);
+
+    const size_t row_size = req.x_pixel_count * 3;
+
+    if (!row_size || (size % row_size))
       return false;
 
-    size_t req_size = req.x_pixel_count * req.y_pixel_count * 3;
+    const size_t row_count = size / row_size;
 
-    if (req_size != size)
+    if ((first_row + row_count) > req.y_pixel_count)
       return false;
 
-    if (m_frame_build_context->ReplyRenderRequest(req, data))
+    makeCurrent();
+
+    QOpenGLVertexArrayObject::Binder vertex_array_binder(&m_vertex_array);
+
+    QOpenGLExtraFunctions* functions = context()->extraFunctions();
+
+    bool preview_changed = m_frame_build_context->ReplyRenderRequestRows(
+      *functions, *index, req, first_row, data, row_count);
+
+    preview_changed |= AccumulateCompleteFrame(*functions);
+
+    m_staging.Recycle(*functions);
+
+    if (preview_changed)
       update();
 
+    vertex_array_binder.release();
+
     doneCurrent();
 
     return true;
@@ -251,8 +1002,10 @@ protected:
 
   void mouseMoveEvent(QMouseEvent* event) override
   {
-    if (hasFocus())
+    if (hasFocus()) {
+      RestartAccumulation();
       NotifyMouseMoveEvent(event->x(), event->y());
+    }
 
     QWidget::mouseMoveEvent(event);
   }
@@ -261,8 +1014,10 @@ protected:
   {
     QString key_text = event->text();
 
-    if (!key_text.isEmpty() && !event->isAutoRepeat())
+    if (!key_text.isEmpty() && !event->isAutoRepeat()) {
+      RestartAccumulation();
       NotifyKeyEvent(key_text, true);
+    }
 
     QOpenGLWidget::keyPressEvent(event);
   }
@@ -271,8 +1026,10 @@ protected:
   {
     QString key_text = event->text();
 
-    if (!key_text.isEmpty() && !event->isAutoRepeat())
+    if (!key_text.isEmpty() && !event->isAutoRepeat()) {
+      RestartAccumulation();
       NotifyKeyEvent(key_text, false);
+    }
 
     QOpenGLWidget::keyPressEvent(event);
   }
@@ -298,6 +1055,8 @@ protected:
     if (button_name.isEmpty())
       return false;
 
+    RestartAccumulation();
+
     View::NotifyMouseButtonEvent(button_name, event->x(), event->y(), state);
 
     return true;
@@ -319,22 +1078,39 @@ protected:
 
   void initializeGL() override
   {
-    m_program.addShaderFromSourceFile(QOpenGLShader::Vertex,
-                                      ":/shaders/blit_partition.vert");
+    m_scatter_program.addShaderFromSourceFile(QOpenGLShader::Vertex,
+                                              ":/shaders/fullscreen.vert");
+
+    m_scatter_program.addShaderFromSourceFile(
+      QOpenGLShader::Fragment, ":/shaders/scatter_partition.frag");
+
+    m_scatter_program.link();
+
+    m_present_program.addShaderFromSourceFile(QOpenGLShader::Vertex,
+                                              ":/shaders/fullscreen.vert");
+
+    m_present_program.addShaderFromSourceFile(
+      QOpenGLShader::Fragment, ":/shaders/present_frame.frag");
+
+    m_present_program.link();
+
+    m_accumulate_program.addShaderFromSourceFile(QOpenGLShader::Vertex,
+                                                 ":/shaders/fullscreen.vert");
+
+    m_accumulate_program.addShaderFromSourceFile(
+      QOpenGLShader::Fragment, ":/shaders/accumulate_frame.frag");
 
-    m_program.addShaderFromSourceFile(QOpenGLShader::Fragment,
-                                      ":/shaders/blit_partition.frag");
+    m_accumulate_program.link();
 
-    m_program.link();
+    // The shaders generate their own vertices, but a vertex array still has to
+    // be bound in the core profile.
+    m_vertex_array.create();
+
+    m_staging.Recycle(*context()->extraFunctions());
   }
 
   void paintGL() override
   {
-    if (!m_frame_build_context)
-      return;
-
-    const Schedule& schedule = m_frame_build_context->GetSchedule();
-
     QOpenGLContext* context = QOpenGLContext::currentContext();
     if (!context)
       return;
@@ -349,68 +1125,407 @@ protected:
 
     functions->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    std::vector<PreviewOperation> preview_operations =
-      schedule.GetPreviewOperations();
+    // While frames are accumulated, the average of the complete ones is shown
+    // instead of the frame being built.
+    if (m_accumulation && m_accumulated_frames) {
+      Present(*functions,
+              m_accumulation->texture(),
+              size_t(m_accumulation->width()),
+              size_t(m_accumulation->height()),
+              1);
+      return;
+    }
+
+    // The last frame is shown, stretched to the size of the view, until the
+    // new one has a preview.
+    if (m_frame_build_context && m_frame_build_context->HasPreview())
+      m_previous_frame.reset();
 
-    const int vertex_attrib = m_program.attributeLocation("vertex");
+    const FrameBuildContext* frame =
+      m_previous_frame ? m_previous_frame.get() : m_frame_build_context.get();
 
-    bool success = m_program.bind();
+    if (!frame || !frame->HasPreview())
+      return;
+
+    const Schedule& schedule = frame->GetSchedule();
+
+    Present(*functions,
+            frame->GetFrameTexture(),
+            schedule.GetTextureWidth(),
+            schedule.GetTextureHeight(),
+            schedule.GetPreviewStride());
+  }
+
+  void resizeGL(int w, int h) override
+  {
+    context()->functions()->glViewport(0, 0, w, h);
+
+    // There is nothing to show until the first frame, so it is not delayed.
+    if (!m_frame_build_context) {
+      ResizeFrameBuildContext();
+      NotifyResize();
+      NotifyNewFrame();
+      return;
+    }
+
+    m_resize_timer.start();
+  }
+
+private:
+  /// Draws a frame texture over the whole view.
+  ///
+  /// @param stride The distance between the pixels that are drawn, each of
+  ///               which fills the square of pixels to its bottom right.
+  void Present(QOpenGLFunctions& functions,
+               GLuint texture,
+               size_t x_frame_size,
+               size_t y_frame_size,
+               size_t stride)
+  {
+    bool success = m_present_program.bind();
 
     assert(success);
 
-    success = m_frame_build_context->GetVertexBuffer().bind();
+    QOpenGLVertexArrayObject::Binder vertex_array_binder(&m_vertex_array);
+
+    m_present_program.setUniformValue("x_frame_size", float(x_frame_size));
+    m_present_program.setUniformValue("y_frame_size", float(y_frame_size));
+
+    m_present_program.setUniformValue("preview_stride", float(stride));
+
+    functions.glBindTexture(GL_TEXTURE_2D, texture);
+
+    functions.glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    functions.glBindTexture(GL_TEXTURE_2D, 0);
+
+    m_present_program.release();
+  }
+
+  /// Drops the frames averaged so far, without starting a new frame.
+  void DiscardAccumulation()
+  {
+    m_accumulated_frames = 0;
+
+    m_frame_is_stale = false;
+  }
+
+  /// Starts the average over after input, which may change what the renderer
+  /// draws. The frame being built may have been rendered before the input, so
+  /// it is not added to the average.
+  void RestartAccumulation()
+  {
+    if (!m_accumulation_enabled)
+      return;
+
+    const bool had_frames = m_accumulated_frames > 0;
+
+    m_accumulated_frames = 0;
+
+    if (HasRenderRequest())
+      m_frame_is_stale = true;
+    else if (m_frame_build_context)
+      StartNextAccumulatedFrame();
+
+    if (had_frames)
+      update();
+  }
+
+  /// Adds the current frame to the average once all of its render requests
+  /// have been replied to, and starts the next one. Expects the context to
+  /// be current.
+  ///
+  /// @return Whether or not the average changed.
+  bool AccumulateCompleteFrame(QOpenGLExtraFunctions& functions)
+  {
+    if (!m_accumulation_enabled || !m_frame_build_context ||
+        HasRenderRequest())
+      return false;
+
+    bool changed = false;
+
+    if (m_frame_is_stale) {
+      m_frame_is_stale = false;
+    } else {
+      Accumulate(functions, *m_frame_build_context);
+      changed = true;
+    }
+
+    if (m_accumulated_frames < max_accumulated_frames)
+      StartNextAccumulatedFrame();
+
+    return changed;
+  }
+
+  /// Blends a complete frame into the average, with a weight that keeps every
+  /// frame of the average weighted the same.
+  void Accumulate(QOpenGLExtraFunctions& functions,
+                  const FrameBuildContext& frame)
+  {
+    const Schedule& schedule = frame.GetSchedule();
+
+    const QSize size(int(schedule.GetFrameWidth()),
+                     int(schedule.GetFrameHeight()));
+
+    if (!m_accumulation || (m_accumulation->size() != size)) {
+
+      m_accumulation.reset(
+        new QOpenGLFramebufferObject(size,
+                                     QOpenGLFramebufferObject::NoAttachment,
+                                     GL_TEXTURE_2D,
+                                     GL_RGBA32F));
+
+      m_accumulation->bind();
+
+      functions.glClearColor(0, 0, 0, 1);
+
+      functions.glClear(GL_COLOR_BUFFER_BIT);
+
+      m_accumulation->release();
+
+      m_accumulated_frames = 0;
+    }
+
+    GLint viewport[4]{};
+
+    functions.glGetIntegerv(GL_VIEWPORT, viewport);
+
+    m_accumulation->bind();
+
+    functions.glViewport(0, 0, size.width(), size.height());
+
+    // The alpha of the average stays opaque.
+    functions.glEnable(GL_BLEND);
+
+    functions.glBlendFuncSeparate(
+      GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ZERO, GL_ONE);
+
+    bool success = m_accumulate_program.bind();
 
     assert(success);
 
-    m_program.enableAttributeArray(vertex_attrib);
+    m_accumulate_program.setUniformValue("x_frame_size", float(size.width()));
+    m_accumulate_program.setUniformValue("y_frame_size", float(size.height()));
+
+    m_accumulate_program.setUniformValue(
+      "weight", 1.0f / float(m_accumulated_frames + 1));
+
+    functions.glBindTexture(GL_TEXTURE_2D, frame.GetFrameTexture());
+
+    functions.glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    functions.glBindTexture(GL_TEXTURE_2D, 0);
 
-    functions->glVertexAttribPointer(
-      vertex_attrib, 4, GL_FLOAT, GL_FALSE, sizeof(float) * 4, 0);
+    m_accumulate_program.release();
 
-    const size_t partition_w = schedule.GetPartitionWidth();
-    const size_t partition_h = schedule.GetPartitionHeight();
+    functions.glDisable(GL_BLEND);
 
-    m_program.setUniformValue("x_partition_size", float(partition_w));
-    m_program.setUniformValue("y_partition_size", float(partition_h));
+    m_accumulation->release();
 
-    for (size_t i = 0; i < preview_operations.size(); i++) {
+    functions.glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
 
-      QOpenGLTexture* texture = m_frame_build_context->GetTexture(i);
+    m_accumulated_frames++;
+  }
 
-      texture->bind();
+  /// Starts the next frame of the average once control returns to the event
+  /// loop, since this may be called while a reply is being uploaded.
+  void StartNextAccumulatedFrame()
+  {
+    if (m_next_frame_pending)
+      return;
 
-      const PreviewOperation& op = preview_operations.at(i);
+    m_next_frame_pending = true;
 
-      m_program.setUniformValue("x_pixel_offset", float(op.x_pixel_offset));
-      m_program.setUniformValue("y_pixel_offset", float(op.y_pixel_offset));
+    QTimer::singleShot(0, this, [this] {
+      m_next_frame_pending = false;
 
-      m_program.setUniformValue("x_pixel_stride", float(op.x_pixel_stride));
-      m_program.setUniformValue("y_pixel_stride", float(op.y_pixel_stride));
+      if (!m_accumulation_enabled)
+        return;
 
-      const int v_count = m_frame_build_context->GetVertexCount();
+      ResetFrameBuildContext();
 
-      functions->glDrawArrays(GL_TRIANGLES, 0, v_count);
+      NotifyNewFrame();
+    });
+  }
+
+  /// Starts building a new frame at the size of the current one, which is the
+  /// size the renderer was last resized to. A resize of the view only takes
+  /// effect through @ref ResizeFrameBuildContext, once it is done.
+  ///
+  /// @param keep_pixels Whether the new frame has the same content as the
+  ///                    current one, so that the pixels received so far can
+  ///                    be kept.
+  void ResetFrameBuildContext(bool keep_pixels = false)
+  {
+    if (!m_frame_build_context) {
+      ResizeFrameBuildContext();
+      return;
     }
 
-    m_program.disableAttributeArray(vertex_attrib);
+    const Schedule& schedule = m_frame_build_context->GetSchedule();
+
+    ResetFrameBuildContext(
+      schedule.GetFrameWidth(), schedule.GetFrameHeight(), keep_pixels);
   }
 
-  void resizeGL(int w, int h) override
+  /// Starts building a new frame at the current size of the view. The
+  /// renderer has to be resized along with it.
+  void ResizeFrameBuildContext()
   {
-    context()->functions()->glViewport(0, 0, w, h);
+    ResetFrameBuildContext(size_t(width()), size_t(height()), false);
+  }
 
-    NotifyResize();
+  /// Starts building a new frame of the given size. If the current frame has
+  /// a preview, it is kept on screen until the new one does.
+  void ResetFrameBuildContext(size_t w, size_t h, bool keep_pixels)
+  {
+    makeCurrent();
+
+    Schedule schedule =
+      m_tile_size
+        ? m_schedules.MakeTiledSchedule(w, h, m_tile_size, m_id_generator)
+        : m_schedules.MakeSchedule(w, h, m_div_level, m_id_generator);
+
+    std::unique_ptr<FrameBuildContext> frame(
+      new FrameBuildContext(std::move(schedule),
+                            m_frame_cache,
+                            m_partitions,
+                            m_scatter_program));
+
+    if (keep_pixels && m_frame_build_context)
+      frame->KeepPixels(*context()->functions(), *m_frame_build_context);
+
+    // Every render request of a frame has the same size.
+    const RenderRequest req = frame->GetSchedule().GetRenderRequest(0);
+
+    m_staging.SetBlockSize(req.x_pixel_count * req.y_pixel_count * 3);
+
+    m_staging.Recycle(*context()->extraFunctions());
+
+    if (m_frame_build_context && m_frame_build_context->HasPreview())
+      m_previous_frame = std::move(m_frame_build_context);
+
+    m_frame_build_context = std::move(frame);
+
+    doneCurrent();
+  }
+
+  /// Uploads the reply, if it is for an outstanding render request of the
+  /// current frame. Expects the context to be current.
+  ///
+  /// @return If the reply was rejected, then a null optional is returned.
+  ///         Otherwise, whether or not a new preview is available.
+  auto AcceptReply(const RenderRequestReply& reply) -> std::optional<bool>
+  {
+    const std::optional<bool> result = UploadReply(reply);
+
+    // A staging block is lent again at once if its pixels were not uploaded.
+    if (!result && reply.staging_block)
+      m_staging.Return(*reply.staging_block);
+
+    return result;
+  }
+
+  auto UploadReply(const RenderRequestReply& reply) -> std::optional<bool>
+  {
+    if (!m_frame_build_context)
+      return std::nullopt;
+
+    const std::optional<size_t> index =
+      m_frame_build_context->FindOutstandingRequest(reply.request_id);
+    if (!index)
+      return std::nullopt;
 
-    NewFrame();
+    const RenderRequest req =
+      m_frame_build_context->GetSchedule().GetRenderRequest(*index);
+
+    const size_t channel_count = reply.has_alpha ? 4 : 3;
+
+    size_t req_size = req.x_pixel_count * req.y_pixel_count * channel_count;
+
+    if (req_size != reply.size)
+      return std::nullopt;
+
+    QOpenGLExtraFunctions* functions = context()->extraFunctions();
+
+    if (!reply.staging_block) {
+      return m_frame_build_context->ReplyRenderRequest(
+        *functions, *index, req, reply);
+    }
+
+    // Nothing but the upload may run while the buffer is bound.
+    m_frame_build_context->Prepare(*functions);
+
+    if (!m_staging.BeginUpload(*reply.staging_block))
+      return std::nullopt;
+
+    // The pixels are at the start of the bound pixel unpack buffer.
+    RenderRequestReply staged_reply = reply;
+
+    staged_reply.data = nullptr;
+
+    m_frame_build_context->UploadReply(*functions, *index, req, staged_reply);
+
+    m_staging.EndUpload(*functions, *reply.staging_block);
+
+    return m_frame_build_context->ScatterReply(*functions, *index, req);
   }
 
 private:
+  /// The layouts of the schedules of recent frame sizes, division levels and
+  /// tile sizes.
+  ScheduleCache m_schedules;
+
+  /// The textures of frames that are done. These are declared before the
+  /// frames, so that the frames can still return their textures while the
+  /// view is destroyed.
+  FrameCache m_frame_cache{ frame_cache_capacity };
+
   std::unique_ptr<FrameBuildContext> m_frame_build_context;
 
-  QOpenGLShaderProgram m_program;
+  /// The last frame that had a preview, while the current one does not.
+  std::unique_ptr<FrameBuildContext> m_previous_frame;
+
+  /// Delays new frames while the view is being resized.
+  QTimer m_resize_timer;
+
+  /// Writes the pixels of a reply into the frame texture.
+  QOpenGLShaderProgram m_scatter_program;
+
+  /// The replies of the current frame, before they are scattered.
+  PartitionArray m_partitions;
+
+  /// The memory that the pixels of replies are decoded into.
+  StagingBuffers m_staging;
+
+  /// Draws the frame texture, filling in the pixels of the current preview.
+  QOpenGLShaderProgram m_present_program;
+
+  /// Blends a complete frame into the average of the accumulated frames.
+  QOpenGLShaderProgram m_accumulate_program;
+
+  /// The average of the complete frames, while frames are accumulated.
+  std::unique_ptr<QOpenGLFramebufferObject> m_accumulation;
+
+  /// The number of frames in the average.
+  size_t m_accumulated_frames = 0;
+
+  bool m_accumulation_enabled = false;
+
+  /// Whether the frame being built started before the last input.
+  bool m_frame_is_stale = false;
+
+  /// Whether the next frame of the average is about to be started.
+  bool m_next_frame_pending = false;
+
+  QOpenGLVertexArrayObject m_vertex_array;
 
   size_t m_div_level = 3;
 
+  /// The size of the tiles that the frame is divided into, or zero if the
+  /// render requests are interleaved.
+  size_t m_tile_size = 0;
+
   IDGenerator m_id_generator;
 };
 
@@ -2,6 +2,7 @@
 
 #include <QOpenGLWidget>
 
+#include <optional>
 #include <vector>
 
 #include <stddef.h>
@@ -14,6 +15,25 @@ struct RenderRequest;
 struct ResizeRequest;
 
 class Schedule;
+class StagingPool;
+
+/// The RGB data for a single render request, used when replying to several
+/// render requests at once.
+struct RenderRequestReply final
+{
+  const unsigned char* data = nullptr;
+
+  size_t size = 0;
+
+  size_t request_id = 0;
+
+  /// Whether the data has four bytes per pixel (RGBA) instead of three (RGB).
+  bool has_alpha = false;
+
+  /// The staging block that the data was decoded into, if any. See @ref
+  /// View::SetStagingPool.
+  std::optional<size_t> staging_block;
+};
 
 class ViewObserver
 {
@@ -50,12 +70,14 @@ public:
 
   virtual bool HasRenderRequest() const = 0;
 
-  /// Gets the current render request made by the view.
+  /// Gets the first render request of the current frame that has not been
+  /// replied to yet.
   ///
   /// @return The current render request.
   virtual RenderRequest GetCurrentRenderRequest() const = 0;
 
-  /// Responds to the current render request with the resultant RGB buffer.
+  /// Responds to a render request of the current frame with the resultant RGB
+  /// buffer. Render requests may be replied to in any order.
   ///
   /// @param data The buffer containing the 24-bit RGB buffer. Should fit all
   ///             24-bit RGB values requested.
@@ -69,10 +91,67 @@ public:
                                   size_t size,
                                   size_t request_id) = 0;
 
+  /// Responds to several render requests at once. The textures for all of the
+  /// replies are uploaded within a single context switch and the view is only
+  /// updated once.
+  ///
+  /// @param replies The replies, in the order they were received.
+  ///
+  /// @param count The number of replies.
+  ///
+  /// @return The number of replies that were accepted.
+  virtual size_t ReplyRenderRequests(const RenderRequestReply* replies,
+                                     size_t count) = 0;
+
+  /// Responds to a render request of the current frame with some of the rows
+  /// of the resultant RGB buffer. This is used for replies that are received
+  /// incrementally. The rows of a reply have to be passed in order, without
+  /// rows of other replies in between, and the reply is complete once the last
+  /// row is passed.
+  ///
+  /// @param request_id The ID of the render request that the rows are for.
+  ///
+  /// @param first_row The index of the first row in the data.
+  ///
+  /// @param data The buffer containing the 24-bit RGB values of the rows.
+  ///
+  /// @param size The number of bytes in the data buffer. This should be a
+  ///             multiple of the row size.
+  ///
+  /// @return True on success, false on failure.
+  virtual bool ReplyRenderRequestRows(size_t request_id,
+                                      size_t first_row,
+                                      const unsigned char* data,
+                                      size_t size) = 0;
+
+  /// Lends mapped pixel buffers to a pool, so that replies can be decoded
+  /// straight into them and uploaded without another copy. A reply that was
+  /// decoded into a block passes its index with the data, and the block is
+  /// lent again once its upload is done. Null takes the available blocks back,
+  /// which has to be done before the pool is destroyed.
+  virtual void SetStagingPool(StagingPool* pool) = 0;
+
   virtual void NewFrame() = 0;
 
+  /// Sets how many times the frame is divided along each dimension, as a
+  /// power of two. If a frame is being built, a new one is started at the new
+  /// level, which keeps the pixels that were already received and only
+  /// requests the rest.
   virtual void SetDivisionLevel(size_t level) = 0;
 
+  /// Sets the size of the square tiles that the frame is divided into, which
+  /// are requested in Morton order. Each tile is contiguous, which suits
+  /// renderers that benefit from coherent pixels, at the cost of the coarse
+  /// previews of the interleaved partitions. Zero switches back to
+  /// interleaved partitions, at the division level.
+  virtual void SetTileSize(size_t tile_size) = 0;
+
+  /// Sets whether or not frames are accumulated. While they are, a new frame
+  /// is started each time one is complete, and the complete frames are shown
+  /// averaged together, which lets a noisy renderer converge. The average
+  /// starts over when the view is resized or receives input.
+  virtual void SetAccumulationEnabled(bool enabled) = 0;
+
   /// Indicates whether or not the view needs to go through the rendering
   /// process again. This can return true if the partition level is changed or
   /// if the window is resized.